@@ -43,7 +43,8 @@ typedef volatile uint8_t                      vuint8_t;
 
 #define MAX_HIGH_CLK_FREQS                    8
 #define MAX_CAP_SUBCHN_COUNT                  3
-#define NUM_CAPTURE_DMA_FRAGS                 3
+#define NUM_CAPTURE_DMA_FRAGS                 3     /* Default depth of the multi-subchn/serializer capture ring */
+#define MAX_CAPTURE_DMA_FRAGS                 32
 #define DEFAULT_CAPTURE_DMA_FRAG_SIZE         (1*1024)
 
 typedef struct McASP
@@ -391,12 +392,28 @@ typedef struct mcasp_subchn {
     ado_pcm_subchn_t   *pcm_subchn;
     ado_pcm_config_t   *pcm_config;
     int32_t            pcm_offset;      /* holds offset of data populated in PCM subchannel buffer */
+    uint32_t           frag_samples;    /* samples per fragment, set at prepare (multi-serializer capture) */
+    uint32_t           buf_samples;     /* samples in the PCM buffer, pcm_offset wraps there */
     uint8_t            go;              /* indicates if trigger GO has been issue by client for data transfer */
+    uint8_t            shared;          /* pcm_config->dmabuf is the capture DMA ring (capture_fanout) */
+    uint8_t            synced;          /* shared: the ring has wrapped since prepare, fragments are signalled */
     void               *strm;           /* pointer back to parent stream structure */
 } mcasp_subchn_t;
 
 #define SERIALIZER_ENABLED 1
 
+/*
+ * DMA position snapshot. Written by the DMA interrupt (seq is odd while it
+ * is being updated) and read by mcasp_position() without hw_lock.
+ */
+typedef struct mcasp_pos {
+    volatile uint32_t  seq;
+    uint32_t           frag;            /* fragments completed since prepare */
+    uint32_t           cidx;            /* bytes per PaRAM frame, 0 if the position is not tracked */
+    uint64_t           stamp;           /* ClockCycles() at the last fragment interrupt */
+    uint64_t           period;          /* cycles between the last two interrupts, 0 if unknown */
+} mcasp_pos_t;
+
 typedef struct mcasp_play_strm {
     ado_pcm_cap_t      pcm_caps;
     ado_pcm_hw_t       pcm_funcs;
@@ -416,7 +433,9 @@ typedef struct mcasp_play_strm {
     uint8_t            serializer[NUMBER_OF_SERIALIZER];
     uint8_t            serializer_cnt;
     uint8_t            fifo_thres;
+    mcasp_pos_t        pos;
     void               *reconstitute_buffer;
+    uint16_t           *interleave_map; /* in reconstitute_buffer, see mcasp_interleave_map() */
 }mcasp_play_strm_t;
 
 typedef struct mcasp_cap_strm {
@@ -448,6 +467,13 @@ typedef struct mcasp_cap_interfaces {
     /* DMA buffer info for multi-subchn and/or multi-serializer devices */
     ado_pcm_dmabuf_t   *dmabuf;
     volatile int32_t   frag_size;          /* Fragment/block size for DMA buffer */
+    uint8_t            fanout;             /* Subchannels matching the DMA ring read it in place */
+    uint32_t           nfrags;             /* Fragments in the DMA ring */
+    uint64_t           frag_cycles;        /* ClockCycles() per fragment at the current rate */
+    uint64_t           last_tc;            /* Estimated completion time of the last fragment */
+    uint32_t           overruns;           /* Fragments overwritten before the interrupt could reload */
+    uint32_t           overrun_events;
+    mcasp_pos_t        pos;
 }mcasp_cap_interface_t;
 
 
@@ -491,6 +517,7 @@ struct mcasp_card {
 #define                FS_WORD           0
 #define                FS_BIT            1
     uint8_t            loopback;
+    uint8_t            pos_interp;      /* Interpolate the position between DMA frames */
 };
 typedef struct mcasp_card mcasp_card_t;
 
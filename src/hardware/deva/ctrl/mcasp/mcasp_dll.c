@@ -25,6 +25,7 @@
  */
 
 #include <mcasp.h>
+#include <sys/syspage.h>
 
 #define MIN(A, B)              ((A)<(B)?(A):(B))
 
@@ -481,14 +482,28 @@ mcasp_capture_aquire(HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T ** pc,
 		}
 	}
 
-	config->dmabuf.flags = ADO_BUF_CACHE;
-	/* If serializer_cnt and nsubchn == 1, then we DMA directly into the pcm buffer, so make it DMA safe */
-	if (mcasp_card->cap_aif.serializer_cnt == 1 && strm->nsubchn == 1)
-		config->dmabuf.flags |= ADO_SHM_DMA_SAFE;
-	if (ado_pcm_buf_alloc(config, config->dmabuf.size, config->dmabuf.flags) == NULL)
+	/* Capture fan-out: a subchannel laid out like the DMA ring is given the ring itself,
+	 * all of them share the one copy written by the DMA.
+	 */
+	ctx->shared = 0;
+	if (mcasp_card->cap_aif.fanout && mcasp_card->cap_aif.serializer_cnt == 1 && strm->nsubchn > 1 &&
+		ado_pcm_dma_int_size(config) == mcasp_card->cap_aif.frag_size &&
+		config->dmabuf.size == mcasp_card->cap_aif.dmabuf->size)
 	{
-		ado_mutex_unlock(&mcasp_card->hw_lock);
-		return (errno);
+		config->dmabuf = *mcasp_card->cap_aif.dmabuf;
+		ctx->shared = 1;
+	}
+	else
+	{
+		config->dmabuf.flags = ADO_BUF_CACHE;
+		/* If serializer_cnt and nsubchn == 1, then we DMA directly into the pcm buffer, so make it DMA safe */
+		if (mcasp_card->cap_aif.serializer_cnt == 1 && strm->nsubchn == 1)
+			config->dmabuf.flags |= ADO_SHM_DMA_SAFE;
+		if (ado_pcm_buf_alloc(config, config->dmabuf.size, config->dmabuf.flags) == NULL)
+		{
+			ado_mutex_unlock(&mcasp_card->hw_lock);
+			return (errno);
+		}
 	}
 
 	/* Only setup DMA for the first active subchn */
@@ -542,13 +557,51 @@ int32_t mcasp_capture_release(HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T *
 {
 	ado_mutex_lock(&mcasp_card->hw_lock);
 	pc->pcm_subchn = NULL;
-	ado_pcm_buf_free(config);
+	/* The capture ring is owned by the card */
+	if (pc->shared)
+		memset(&config->dmabuf, 0, sizeof (config->dmabuf));
+	else
+		ado_pcm_buf_free(config);
+	pc->shared = 0;
 	pc->pcm_config = NULL;
 	ado_mutex_unlock(&mcasp_card->hw_lock);
 	return (0);
 }
 
 
+/*
+ * DMA position snapshot, see mcasp_position(). The writers (prepare and the
+ * fragment interrupts) hold the seq odd while updating.
+ */
+#define MCASP_POS_TRIES        4
+
+static void
+mcasp_pos_reset(mcasp_pos_t *pos, uint32_t cidx)
+{
+	pos->seq++;
+	__cpu_membarrier();
+	pos->frag = 0;
+	pos->cidx = cidx;
+	pos->stamp = 0;
+	pos->period = 0;
+	__cpu_membarrier();
+	pos->seq++;
+}
+
+static void
+mcasp_pos_publish(mcasp_pos_t *pos)
+{
+	uint64_t now = ClockCycles();
+
+	pos->seq++;
+	__cpu_membarrier();
+	pos->period = pos->frag ? now - pos->stamp : 0;
+	pos->stamp = now;
+	pos->frag++;
+	__cpu_membarrier();
+	pos->seq++;
+}
+
 int32_t mcasp_prepare(HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T * subchn, ado_pcm_config_t * config)
 {
 
@@ -565,6 +618,7 @@ int32_t mcasp_prepare(HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T * subchn,
 		/* Reset the CCNT (Frames per param set) */
 		mcasp_card->edma3->PaRAM[strm->dma_idx].CCNT =
 			(ado_pcm_dma_int_size(config) / (mcasp_card->sample_size * mcasp_card->play_strm.fifo_thres));
+		mcasp_pos_reset(&strm->pos, mcasp_card->sample_size * strm->fifo_thres);
 	}
 	else
 	{
@@ -583,10 +637,27 @@ int32_t mcasp_prepare(HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T * subchn,
 			/* Reset the CCNT (Frames per param set) */
 			mcasp_card->edma3->PaRAM[strm->dma_idx].CCNT =
 				(mcasp_card->cap_aif.frag_size / (mcasp_card->sample_size * mcasp_card->cap_aif.fifo_thres));
+			/* The DMA only goes straight to the client buffer with one serializer and subchannel,
+			 * otherwise data is copied out at the fragment interrupt and the DMA position is not
+			 * the client's.
+			 */
+			if (mcasp_card->cap_aif.serializer_cnt == 1 && strm->nsubchn == 1)
+				mcasp_pos_reset(&mcasp_card->cap_aif.pos, mcasp_card->sample_size * mcasp_card->cap_aif.fifo_thres);
+			else
+				mcasp_pos_reset(&mcasp_card->cap_aif.pos, 0);
+
+			/* Fragment time for the overrun check, the DMA moves a sample of every voice on every serializer per frame */
+			mcasp_card->cap_aif.last_tc = 0;
+			mcasp_card->cap_aif.frag_cycles = (uint64_t)mcasp_card->cap_aif.frag_size * SYSPAGE_ENTRY(qtime)->cycles_per_sec /
+				((uint64_t)config->format.rate * strm->voices * mcasp_card->cap_aif.serializer_cnt * mcasp_card->sample_size);
 		}
 		ado_mutex_unlock(&mcasp_card->hw_lock);
 		mcasp_card->cap_aif.pcm_completed_frag = 0;
 		subchn->pcm_offset = 0; /* reset pcm offset */
+		subchn->synced = 0;
+		/* Run lengths of serializer_dmacapture() */
+		subchn->frag_samples = ado_pcm_dma_int_size(config) / mcasp_card->sample_size;
+		subchn->buf_samples = (config->dmabuf.size + mcasp_card->sample_size - 1) / mcasp_card->sample_size;
 	}
 	return (0);
 }
@@ -783,25 +854,76 @@ int32_t mcasp_trigger(HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T * pc, uint
 
 uint32_t mcasp_position(HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T * pc, ado_pcm_config_t * config)
 {
-	uint32_t pos;
-
-	ado_mutex_lock(&mcasp_card->hw_lock);
+	mcasp_pos_t *snap;
+	uint32_t dma_idx, seq, cidx, ccnt, pos, ipos, frag_size, tries = 0;
+	uint64_t stamp, period, now;
 
 	if (pc->pcm_subchn == mcasp_card->play_strm.subchn.pcm_subchn)
 	{
 		mcasp_play_strm_t *strm = pc->strm;
 
-		/* AB-Synchronized Transfers: position = Frag size - (samples left * tx_serializer_count * sample size) */
-		pos = ado_pcm_dma_int_size(config) - (mcasp_card->edma3->PaRAM[strm->dma_idx].CCNT * mcasp_card->edma3->PaRAM[strm->dma_idx].SRCCIDX);
+		snap = &strm->pos;
+		dma_idx = strm->dma_idx;
 	}
 	else
 	{
 		mcasp_cap_strm_t *strm = pc->strm;
 
-		/* AB-Synchronized Transfers: position = Frag size - (samples left * rx_serializer_count * sample size) */
-		pos = ado_pcm_dma_int_size(config) - (mcasp_card->edma3->PaRAM[strm->dma_idx].CCNT * mcasp_card->edma3->PaRAM[strm->dma_idx].SRCCIDX);
+		snap = &mcasp_card->cap_aif.pos;
+		dma_idx = strm->dma_idx;
+	}
+
+	/*
+	 * Read the snapshot and the live CCNT without hw_lock, retrying if a
+	 * fragment interrupt published in between. Should the interrupt thread
+	 * keep being caught mid-update (e.g. preempted by this thread), take
+	 * hw_lock, which it holds while publishing.
+	 */
+	for (;;)
+	{
+		seq = snap->seq;
+		if ((seq & 1) == 0)
+		{
+			__cpu_membarrier();
+			cidx = snap->cidx;
+			stamp = snap->stamp;
+			period = snap->period;
+			/* AB-Synchronized Transfers: frames left in the fragment */
+			ccnt = mcasp_card->edma3->PaRAM[dma_idx].CCNT;
+			now = ClockCycles();
+			__cpu_membarrier();
+			if (snap->seq == seq)
+				break;
+		}
+		if (++tries == MCASP_POS_TRIES)
+		{
+			ado_mutex_lock(&mcasp_card->hw_lock);
+			cidx = snap->cidx;
+			stamp = snap->stamp;
+			period = snap->period;
+			ccnt = mcasp_card->edma3->PaRAM[dma_idx].CCNT;
+			now = ClockCycles();
+			ado_mutex_unlock(&mcasp_card->hw_lock);
+			break;
+		}
+	}
+
+	/* position = Frag size - (frames left * serializer_count * fifo threshold * sample size) */
+	frag_size = ado_pcm_dma_int_size(config);
+	pos = frag_size - ccnt * cidx;
+
+	/*
+	 * The DMA position moves one frame (cidx bytes) at a time, estimate where
+	 * in that frame we are from the time since the fragment started, within
+	 * the frame that is being transferred.
+	 */
+	if (mcasp_card->pos_interp && cidx && period && pos < frag_size)
+	{
+		ipos = (uint32_t)(((now - stamp) * frag_size) / period);
+		ipos -= ipos % mcasp_card->sample_size;
+		if (ipos > pos)
+			pos = MIN(ipos, MIN(pos + cidx, frag_size) - mcasp_card->sample_size);
 	}
-	ado_mutex_unlock(&mcasp_card->hw_lock);
 	return (pos);
 }
 
@@ -845,6 +967,7 @@ void mcasp_play_interrupt(mcasp_card_t * mcasp_card, int32_t irq)
 
 		mcasp_card->edma3->PaRAM[DMA_RELOAD + mcasp_card->play_strm.dma_idx].SRC =
 			config->dmabuf.phys_addr + mcasp_card->play_strm.pcm_cur_frag++ * ado_pcm_dma_int_size(config);
+		mcasp_pos_publish(&mcasp_card->play_strm.pos);
 		status = mcasp_card->play_strm.dma_idx;
 	}
 
@@ -858,6 +981,8 @@ void mcasp_play_interrupt(mcasp_card_t * mcasp_card, int32_t irq)
  * This function is used when more than 1 capture subchannel have been enabled. It is called from
  * rx interrupt handler (or pulse). It manually copies data from global dma buffer to client
  * PCM buffer and notifies io-audio when a complete fragment has been transferred.
+ * Subchannels sharing the ring (capture_fanout) are only notified, the ring was invalidated
+ * by serializer_dmacapture().
  */
 static void
 subchn_dmacapture(HW_CONTEXT_T *mcasp_card, uint8_t *srcDMAAddr, uint32_t size)
@@ -878,7 +1003,21 @@ subchn_dmacapture(HW_CONTEXT_T *mcasp_card, uint8_t *srcDMAAddr, uint32_t size)
 	{
 		ctx = &mcasp_card->cap_aif.cap_strm[0].subchn[idx];
 		config = ctx->pcm_config;
-		if((NULL != ctx->pcm_subchn) && (1 == ctx->go))
+		if((NULL != ctx->pcm_subchn) && (1 == ctx->go) && ctx->shared)
+		{
+			/* The client reads the ring in place. It starts on the first ring fragment after it was
+			 * started, so that its buffer offsets are the ring's, and then gets every fragment.
+			 */
+			if (srcDMAAddr == (uint8_t *)mcasp_card->cap_aif.dmabuf->addr)
+				ctx->synced = 1;
+			if (ctx->synced)
+			{
+				ctx->pcm_offset = (srcDMAAddr + size) - (uint8_t *)mcasp_card->cap_aif.dmabuf->addr;
+				ctx->pcm_offset %= config->dmabuf.size;
+				dma_interrupt(ctx->pcm_subchn);
+			}
+		}
+		else if((NULL != ctx->pcm_subchn) && (1 == ctx->go))
 		{
 			uint32_t remaining = 0;
 			bytesTransferred = 0;
@@ -906,21 +1045,60 @@ subchn_dmacapture(HW_CONTEXT_T *mcasp_card, uint8_t *srcDMAAddr, uint32_t size)
 	}
 }
 
+/*
+ * Copy every stride-th sample of src to dst. The stride is a constant in
+ * each case so that the compiler can use the structure loads of the CPU
+ * (vld2/vld3/vld4 on NEON) for the common serializer counts.
+ */
+#define DEINTERLEAVE_KERNEL(name, type)                                           \
+static void                                                                       \
+name(type * __restrict dst, const type * __restrict src, uint32_t stride, uint32_t n) \
+{                                                                                 \
+	uint32_t i;                                                                   \
+                                                                                  \
+	switch (stride)                                                               \
+	{                                                                             \
+		case 2:                                                                   \
+			for (i = 0; i < n; i++)                                               \
+				dst[i] = src[2 * i];                                              \
+			break;                                                                \
+		case 3:                                                                   \
+			for (i = 0; i < n; i++)                                               \
+				dst[i] = src[3 * i];                                              \
+			break;                                                                \
+		case 4:                                                                   \
+			for (i = 0; i < n; i++)                                               \
+				dst[i] = src[4 * i];                                              \
+			break;                                                                \
+		default:                                                                  \
+			for (i = 0; i < n; i++)                                               \
+				dst[i] = src[stride * i];                                         \
+			break;                                                                \
+	}                                                                             \
+}
+
+DEINTERLEAVE_KERNEL(deinterleave16, uint16_t)
+DEINTERLEAVE_KERNEL(deinterleave32, uint32_t)
+
 /**
  * This function is used when more than 1 capture serializers have been enabled. It is called from
  * rx interrupt handler (or pulse). Data from each serializer is interleaved into a single DMA buffer
  * this routine splits the interleaved data into separate "virtual" device buffers/streams and notifies
  * io-audio when a full fragment worth of data is transfered per "virtual" device/stream.
+ *
+ * Each subchannel is copied in runs that end at the end of the DMA data, at the wrap of its PCM buffer
+ * or at a fragment boundary, so those are checked once per run. frag_samples and buf_samples are set
+ * by mcasp_prepare().
  */
 static void
 serializer_dmacapture(HW_CONTEXT_T *mcasp_card, uint8_t *srcDMAAddr, uint32_t size)
 {
-	int32_t idx, sample_offset = 0, cnt;
+	int32_t idx, cnt;
+	uint32_t nser = mcasp_card->cap_aif.serializer_cnt;
+	uint32_t ssize = mcasp_card->sample_size;
+	uint32_t nframes, done, run;
 	mcasp_subchn_t *ctx;
-	uint16_t *buf16;
-	uint32_t *buf32;
-	uint16_t *dmaptr16 = (uint16_t*) srcDMAAddr;
-	uint32_t *dmaptr32 = (uint32_t*) srcDMAAddr;
+	uint8_t *dst;
 
 	if((NULL == srcDMAAddr) || (0 == size))
 	{
@@ -931,54 +1109,115 @@ serializer_dmacapture(HW_CONTEXT_T *mcasp_card, uint8_t *srcDMAAddr, uint32_t si
 	/* Invalidate cache for local DMA buffer */
 	msync(srcDMAAddr, size, MS_INVALIDATE);
 
-	if (mcasp_card->cap_aif.serializer_cnt == 1)
+	if (nser == 1)
+	{
 		subchn_dmacapture(mcasp_card, srcDMAAddr, size);
-	else
+		return;
+	}
+
+	/* Samples per serializer, a partial last frame is copied whole */
+	nframes = (size / ssize + nser - 1) / nser;
+
+	for (cnt = 0; cnt < nser; cnt++)
 	{
-		/* Note: pcm_offset is in samples not bytes, so we must convert to bytes by multiplying by the sample size */
-		while ((sample_offset * mcasp_card->sample_size) < size)
+		for(idx = 0; idx < mcasp_card->cap_aif.cap_strm[cnt].nsubchn; idx++)
 		{
-			for (cnt = 0; cnt < mcasp_card->cap_aif.serializer_cnt; cnt++ )
+			ctx = &mcasp_card->cap_aif.cap_strm[cnt].subchn[idx];
+			if((NULL == ctx->pcm_subchn) || (1 != ctx->go) || (0 == ctx->frag_samples))
+				continue;
+
+			/* Note: pcm_offset is in samples not bytes */
+			for (done = 0; done < nframes; done += run)
 			{
-				for(idx = 0; idx < mcasp_card->cap_aif.cap_strm[cnt].nsubchn; idx++)
+				if (ctx->pcm_offset >= ctx->buf_samples)
+					ctx->pcm_offset = 0;
+
+				run = MIN(nframes - done, ctx->buf_samples - ctx->pcm_offset);
+				run = MIN(run, ctx->frag_samples - ctx->pcm_offset % ctx->frag_samples);
+
+				dst = (uint8_t *)ctx->pcm_config->dmabuf.addr + ctx->pcm_offset * ssize;
+				if (ssize == 2)
+					deinterleave16((uint16_t *)dst, (uint16_t *)srcDMAAddr + done * nser + cnt, nser, run);
+				else
+					deinterleave32((uint32_t *)dst, (uint32_t *)srcDMAAddr + done * nser + cnt, nser, run);
+
+				ctx->pcm_offset += run;
+				if ((ctx->pcm_offset % ctx->frag_samples) == 0)
 				{
-					ctx = &mcasp_card->cap_aif.cap_strm[cnt].subchn[idx];
-					if((NULL != ctx->pcm_subchn) && (1 == ctx->go))
-					{
-						if ((ctx->pcm_offset * mcasp_card->sample_size ) >= ctx->pcm_config->dmabuf.size)
-							ctx->pcm_offset = 0;
-						if (mcasp_card->sample_size == 2)
-						{
-							buf16 = (uint16_t*) ctx->pcm_config->dmabuf.addr + ctx->pcm_offset;
-							*buf16 = dmaptr16[sample_offset];
-						}
-						else
-						{
-							buf32 = (uint32_t*) ctx->pcm_config->dmabuf.addr + ctx->pcm_offset;
-							*buf32 = dmaptr32[sample_offset];
-						}
-						ctx->pcm_offset++;
-						if (((ctx->pcm_offset * mcasp_card->sample_size) % ado_pcm_dma_int_size(ctx->pcm_config)) == 0)
-						{
-							// Signal to io-audio (DMA transfer was completed)
-							dma_interrupt(ctx->pcm_subchn);
-						}
-					}
+					// Signal to io-audio (DMA transfer was completed)
+					dma_interrupt(ctx->pcm_subchn);
 				}
-				sample_offset++;
 			}
 		}
 	}
 }
 
+/*
+ * The interrupt reloads DST of the link set for the fragment after next. When it runs late
+ * by more than a fragment, the DMA reuses the stale link set and writes the same ring slot
+ * again, so the slot the DMA is in does not show the lag. Instead, the completion time of
+ * the fragment just handled is estimated from the hardware position in the next one, and
+ * the time between consecutive completions gives the fragments that went by for each
+ * pcm_completed_frag step. Called with hw_lock held, returns the fragments lost.
+ */
+static uint32_t
+mcasp_cap_missed_frags(mcasp_card_t * mcasp_card)
+{
+	mcasp_cap_interface_t *cap_aif = &mcasp_card->cap_aif;
+	uint32_t dma_idx = cap_aif->cap_strm[0].dma_idx;
+	uint32_t pos, nfrag;
+	uint64_t tc;
+
+	if (cap_aif->frag_cycles == 0)
+		return 0;
+
+	pos = cap_aif->frag_size - mcasp_card->edma3->PaRAM[dma_idx].CCNT * mcasp_card->edma3->PaRAM[dma_idx].DSTCIDX;
+	tc = cap_aif->pos.stamp - (uint64_t)pos * cap_aif->frag_cycles / cap_aif->frag_size;
+
+	nfrag = 1;
+	if (cap_aif->last_tc && tc > cap_aif->last_tc)
+		nfrag = (tc - cap_aif->last_tc + cap_aif->frag_cycles / 2) / cap_aif->frag_cycles;
+	cap_aif->last_tc = tc;
+
+	if (nfrag <= 1)
+		return 0;
+
+	cap_aif->overruns += nfrag - 1;
+	cap_aif->overrun_events++;
+	return nfrag - 1;
+}
+
+/*
+ * Report a capture overrun to io-audio on every running subchannel, the clients
+ * recover by preparing again, which restarts the ring.
+ */
+static void
+mcasp_cap_overrun(mcasp_card_t * mcasp_card)
+{
+	int cnt, idx;
+	mcasp_subchn_t *ctx;
+
+	for (cnt = 0; cnt < mcasp_card->cap_aif.serializer_cnt; cnt++)
+	{
+		for (idx = 0; idx < mcasp_card->cap_aif.cap_strm[cnt].nsubchn; idx++)
+		{
+			ctx = &mcasp_card->cap_aif.cap_strm[cnt].subchn[idx];
+			if (ctx->pcm_subchn != NULL && ctx->go)
+				ado_pcm_error(ctx->pcm_subchn, SND_PCM_STATUS_OVERRUN);
+		}
+	}
+}
+
 void mcasp_cap_interrupt(mcasp_card_t * mcasp_card, int32_t irq)
 {
 	ado_pcm_config_t *config;
+	uint32_t missed = 0;
 
 	ado_mutex_lock(&mcasp_card->hw_lock);
 	/* Setup next param set */
 	if (mcasp_card->cap_aif.active > 0)
 	{
+		mcasp_pos_publish(&mcasp_card->cap_aif.pos);
 		if (mcasp_card->cap_aif.serializer_cnt == 1 && mcasp_card->cap_aif.cap_strm[0].nsubchn == 1)
 		{
 			config = mcasp_card->cap_aif.cap_strm[0].subchn[0].pcm_config;
@@ -990,17 +1229,25 @@ void mcasp_cap_interrupt(mcasp_card_t * mcasp_card, int32_t irq)
 		}
 		else
 		{
-			if (mcasp_card->cap_aif.pcm_cur_frag * mcasp_card->cap_aif.frag_size >= (mcasp_card->cap_aif.frag_size * NUM_CAPTURE_DMA_FRAGS))
+			if (mcasp_card->cap_aif.pcm_cur_frag >= mcasp_card->cap_aif.nfrags)
 			{
 				mcasp_card->cap_aif.pcm_cur_frag = 0;
 			}
 			mcasp_card->edma3->PaRAM[DMA_RELOAD + mcasp_card->cap_aif.cap_strm[0].dma_idx].DST =
 				mcasp_card->cap_aif.dmabuf->phys_addr + mcasp_card->cap_aif.pcm_cur_frag++ * mcasp_card->cap_aif.frag_size;
+			missed = mcasp_cap_missed_frags(mcasp_card);
 		}
 	}
 
 	ado_mutex_unlock(&mcasp_card->hw_lock);
 
+	if (missed)
+	{
+		ado_error("mcasp: capture DMA overrun, %d fragment(s) lost (%d in %d overruns)", missed,
+				  mcasp_card->cap_aif.overruns, mcasp_card->cap_aif.overrun_events);
+		mcasp_cap_overrun(mcasp_card);
+	}
+
 	if(mcasp_card->cap_aif.active > 0)
 	{
 		if(mcasp_card->cap_aif.serializer_cnt == 1 && mcasp_card->cap_aif.cap_strm[0].nsubchn == 1)
@@ -1008,7 +1255,7 @@ void mcasp_cap_interrupt(mcasp_card_t * mcasp_card, int32_t irq)
 		else
 		{
 			int offset = mcasp_card->cap_aif.pcm_completed_frag++ * mcasp_card->cap_aif.frag_size;
-			if (mcasp_card->cap_aif.pcm_completed_frag >= NUM_CAPTURE_DMA_FRAGS)
+			if (mcasp_card->cap_aif.pcm_completed_frag >= mcasp_card->cap_aif.nfrags)
 				mcasp_card->cap_aif.pcm_completed_frag = 0;
 			serializer_dmacapture(mcasp_card, (uint8_t*)(&mcasp_card->cap_aif.dmabuf->addr[offset]), mcasp_card->cap_aif.frag_size);
 		}
@@ -1112,6 +1359,9 @@ mcasp_parse_commandline(HW_CONTEXT_T * mcasp_card, char *args)
 		"xclk_pol",          // 27
 		"rclk_pol",          // 28
 		"loopback",          // 29
+		"pos_interp",        // 30
+		"capture_fanout",    // 31
+		"capture_frags",     // 32
 		NULL
 	};
 
@@ -1161,6 +1411,7 @@ mcasp_parse_commandline(HW_CONTEXT_T * mcasp_card, char *args)
 	mcasp_card->slot_num = TDM_NSLOTS;
 	for (i=0; i < NUMBER_OF_SERIALIZER; i++)
 		mcasp_card->cap_aif.cap_strm[i].nsubchn = 1;
+	mcasp_card->cap_aif.nfrags = NUM_CAPTURE_DMA_FRAGS;
 
 	while (args != NULL && args[0] != 0)
 	{
@@ -1569,6 +1820,23 @@ mcasp_parse_commandline(HW_CONTEXT_T * mcasp_card, char *args)
 			case 29:
 				mcasp_card->loopback = 1;
 				break;
+			case 30:
+				mcasp_card->pos_interp = 1;
+				break;
+			case 31:
+				mcasp_card->cap_aif.fanout = 1;
+				break;
+			case 32:
+				if (value != NULL)
+				{
+					mcasp_card->cap_aif.nfrags = atoi(value);
+					if (mcasp_card->cap_aif.nfrags < 2 || mcasp_card->cap_aif.nfrags > MAX_CAPTURE_DMA_FRAGS)
+					{
+						ado_error ("Invalid capture_frags, must be 2-%d", MAX_CAPTURE_DMA_FRAGS);
+						return EINVAL;
+					}
+				}
+				break;
 			default:
 				break;
 		}
@@ -1755,60 +2023,69 @@ mcasp_parse_commandline(HW_CONTEXT_T * mcasp_card, char *args)
 	return(EOK);
 }
 
-int32_t
-mcasp_playback_reconstitute16 (HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T * pc, int8_t * dmaptr, size_t size)
+/*
+ * When using multiple serializers, each sample shifted out will go
+ * to the next active serializer, so we must re-organize the samples
+ * to get the expected output (i.e. Left and right samples on the same serializer
+ * rather then slpit over multiple serializers).
+ *
+ * The client data is processed in blocks of serializer_cnt frames. Within
+ * a block, TX sample (voice * serializer_cnt + k) is client sample
+ * (k * voices + voice), that is the serializer_cnt x voices block is
+ * transposed. The map holds the client sample of each TX sample, it is
+ * built once for the configured layout.
+ */
+static void
+mcasp_interleave_map(mcasp_play_strm_t *strm)
 {
-	int16_t i, src_idx, dst_idx, iter, *ptr;
-	uint16_t *buffer = mcasp_card->play_strm.reconstitute_buffer;
+	uint32_t voice, k;
 
-	ptr = (int16_t *) dmaptr;
-
-	/*
-	 * When using multiple serializers, each sample shifted out will go
-	 * to the next active serializer, so we must re-organize the samples
-	 * to get the expected output (i.e. Left and right samples on the same serializer
-	 * rather then slpit over multiple serializers).
-	 */
-	for (i = 0; i < (size / sizeof (int16_t)); i+=(mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt))
-	{
-		dst_idx = 0;
-		for (iter = 0; dst_idx < (mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt); iter++)
-		{
-			for(src_idx = iter; src_idx < (mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt); src_idx+=mcasp_card->play_strm.voices, dst_idx++)
-				buffer[dst_idx] = ptr[i + src_idx];
-		}
-		memcpy (&ptr[i], &buffer[0], (mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt)*sizeof(int16_t));
-	}
+	for (voice = 0; voice < strm->voices; voice++)
+		for (k = 0; k < strm->serializer_cnt; k++)
+			strm->interleave_map[voice * strm->serializer_cnt + k] = k * strm->voices + voice;
+}
 
-	return (0);
+#define RECONSTITUTE_KERNEL(name, type)                                           \
+int32_t                                                                           \
+name (HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T * pc, int8_t * dmaptr, size_t size) \
+{                                                                                 \
+	mcasp_play_strm_t *strm = &mcasp_card->play_strm;                             \
+	const uint16_t *map = strm->interleave_map;                                   \
+	uint32_t block = strm->voices * strm->serializer_cnt;                         \
+	uint32_t i, j, n = size / sizeof (type);                                      \
+	type *buffer = strm->reconstitute_buffer;                                     \
+	type *ptr = (type *) dmaptr;                                                  \
+                                                                                  \
+	/* whole blocks of the written region only, never past dmaptr + size */       \
+	n -= n % block;                                                               \
+	for (i = 0; i < n; i += block)                                                \
+	{                                                                             \
+		for (j = 0; j < block; j++)                                               \
+			buffer[j] = ptr[i + map[j]];                                          \
+		memcpy (&ptr[i], buffer, block * sizeof (type));                          \
+	}                                                                             \
+                                                                                  \
+	return (0);                                                                   \
 }
 
-int32_t
-mcasp_playback_reconstitute32 (HW_CONTEXT_T * mcasp_card, PCM_SUBCHN_CONTEXT_T * pc, int8_t * dmaptr, size_t size)
-{
-	int32_t i, src_idx, dst_idx, iter, *ptr;
-	uint32_t *buffer = mcasp_card->play_strm.reconstitute_buffer;
+RECONSTITUTE_KERNEL(mcasp_playback_reconstitute16, uint16_t)
+RECONSTITUTE_KERNEL(mcasp_playback_reconstitute32, uint32_t)
 
-	ptr = (int32_t *) dmaptr;
+/*
+ * Pick the reconstitute kernel for the configured serializer count,
+ * voices and sample size.
+ */
+static void
+mcasp_select_reconstitute(mcasp_card_t * mcasp_card)
+{
+	mcasp_play_strm_t *strm = &mcasp_card->play_strm;
 
-	/*
-	 * When using multiple serializers, each sample shifted out will go
-	 * to the next active serializer, so we must re-organize the samples
-	 * to get the expected output (i.e. Left and right samples on the same serializer
-	 * rather then slpit over multiple serializers).
-	 */
-	for (i = 0; i < (size / sizeof (int32_t)); i+=(mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt))
-	{
-		dst_idx = 0;
-		for (iter = 0; dst_idx < (mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt); iter++)
-		{
-			for(src_idx = iter; src_idx < (mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt); src_idx+=mcasp_card->play_strm.voices, dst_idx++)
-				buffer[dst_idx] = ptr[i + src_idx];
-		}
-		memcpy (&ptr[i], &buffer[0], (mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt)*sizeof(int32_t));
-	}
+	mcasp_interleave_map(strm);
 
-	return (0);
+	if (mcasp_card->sample_size == 2)
+		strm->pcm_funcs.reconstitute2 = mcasp_playback_reconstitute16;
+	else
+		strm->pcm_funcs.reconstitute2 = mcasp_playback_reconstitute32;
 }
 
 void mcasp_init(mcasp_card_t * mcasp_card)
@@ -2328,7 +2605,7 @@ int ctrl_init(HW_CONTEXT_T ** hw_context, ado_card_t * card, char *args)
 			ado_free(mcasp_card);
 			return (errno);
 		}
-		mcasp_card->cap_aif.dmabuf->size = mcasp_card->cap_aif.frag_size * NUM_CAPTURE_DMA_FRAGS;
+		mcasp_card->cap_aif.dmabuf->size = mcasp_card->cap_aif.frag_size * mcasp_card->cap_aif.nfrags;
 
 		mcasp_card->cap_aif.dmabuf->flags = ADO_SHM_DMA_SAFE | ADO_BUF_CACHE;
 		if((mcasp_card->cap_aif.dmabuf->addr = ado_shm_alloc(mcasp_card->cap_aif.dmabuf->size, mcasp_card->cap_aif.dmabuf->name, mcasp_card->cap_aif.dmabuf->flags, &mcasp_card->cap_aif.dmabuf->phys_addr)) == NULL)
@@ -2455,13 +2732,15 @@ int ctrl_init(HW_CONTEXT_T ** hw_context, ado_card_t * card, char *args)
 	/* If using multiple serializers we must allocate a reconstitute buffer and set the reconstitute callback */
 	if (mcasp_card->play_strm.serializer_cnt > 1)
 	{
-		mcasp_card->play_strm.reconstitute_buffer = ado_calloc ( 1, mcasp_card->sample_size * mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt);
+		/* The interleave map follows the block buffer */
+		int block = mcasp_card->play_strm.voices * mcasp_card->play_strm.serializer_cnt;
+
+		mcasp_card->play_strm.reconstitute_buffer = ado_calloc ( 1, (mcasp_card->sample_size + sizeof (uint16_t)) * block);
 		if (mcasp_card->play_strm.reconstitute_buffer != NULL)
 		{
-			if (mcasp_card->sample_size == 2)
-				mcasp_card->play_strm.pcm_funcs.reconstitute2 = mcasp_playback_reconstitute16;
-			else
-				mcasp_card->play_strm.pcm_funcs.reconstitute2 = mcasp_playback_reconstitute32;
+			mcasp_card->play_strm.interleave_map =
+				(uint16_t *)((uint8_t *)mcasp_card->play_strm.reconstitute_buffer + mcasp_card->sample_size * block);
+			mcasp_select_reconstitute(mcasp_card);
 		}
 	}
 
@@ -337,6 +337,51 @@ typedef struct _sdmmc_pwr_mgnt {
 	_Uint32t		rsvd1[16];
 } SDMMC_PWR_MGNT;
 
+typedef struct _sdmmc_bkops_stats {
+#define SDMMC_BS_ACTION_GET		0x00
+#define SDMMC_BS_ACTION_CLR		0x01
+	_Uint32t		action;
+	_Uint32t		rsvd;
+
+	_Uint64t		time;				/* time in ms spent in background operations */
+	_Uint64t		starts;				/* background operations started */
+	_Uint64t		preempts;			/* background operations interrupted by HPI */
+	_Uint64t		idle_time;			/* time in ms idle before starting */
+#define SDMMC_BS_LEVEL_NONE			0
+#define SDMMC_BS_LEVEL_NON_CRITICAL	1
+#define SDMMC_BS_LEVEL_IMPACTED		2
+#define SDMMC_BS_LEVEL_CRITICAL		3
+	_Uint64t		levels[4];			/* BKOPS_STATUS urgency levels reported */
+	_Uint32t		rsvd1[16];
+} SDMMC_BKOPS_STATS;
+
+typedef struct _sdmmc_ra_stats {
+#define SDMMC_RA_ACTION_GET		0x00
+#define SDMMC_RA_ACTION_CLR		0x01
+	_Uint32t		action;
+	_Uint32t		window;				/* read-ahead window in bytes */
+
+	_Uint64t		hits;				/* reads served from the read-ahead cache */
+	_Uint64t		misses;				/* reads sent to the device */
+	_Uint64t		fills;				/* read-ahead transfers */
+	_Uint64t		fill_blks;			/* blocks read ahead */
+	_Uint64t		invals;				/* cache invalidations */
+	_Uint32t		rsvd1[16];
+} SDMMC_RA_STATS;
+
+typedef struct _sdmmc_pipeline_stats {
+#define SDMMC_PL_ACTION_GET		0x00
+#define SDMMC_PL_ACTION_CLR		0x01
+	_Uint32t		action;
+	_Uint32t		rsvd;
+
+	_Uint64t		xfers;				/* data transfers started */
+	_Uint64t		prepared;			/* transfers prepared while the bus was busy */
+	_Uint64t		gaps;				/* back to back transfers (< 1ms apart) */
+	_Uint64t		gap_time;			/* bus idle time in ns between them */
+	_Uint32t		rsvd1[16];
+} SDMMC_PIPELINE_STATS;
+
 #define DCMD_SDMMC_DEVICE_INFO			__DIOF(_DCMD_CAM, _SIM_SDMMC + 0, struct _sdmmc_device_info)
 #define DCMD_SDMMC_DEVICE_HEALTH		__DIOF(_DCMD_CAM, _SIM_SDMMC + 1, union _sdmmc_device_health)
 #define DCMD_SDMMC_ERASE 			  	__DIOTF(_DCMD_CAM, _SIM_SDMMC + 2, struct _sdmmc_erase)
@@ -349,6 +394,9 @@ typedef struct _sdmmc_pwr_mgnt {
 #define DCMD_SDMMC_LOCK_UNLOCK			__DIOT(_DCMD_CAM, _SIM_SDMMC + 9, struct _sdmmc_lock_unlock)
 #define DCMD_SDMMC_PART_INFO			__DIOTF(_DCMD_CAM, _SIM_SDMMC + 10, struct _sdmmc_partition_info)
 #define DCMD_SDMMC_PWR_MGNT				__DIOTF(_DCMD_CAM, _SIM_SDMMC + 11, struct _sdmmc_pwr_mgnt)
+#define DCMD_SDMMC_BKOPS_STATS			__DIOTF(_DCMD_CAM, _SIM_SDMMC + 12, struct _sdmmc_bkops_stats)
+#define DCMD_SDMMC_RA_STATS				__DIOTF(_DCMD_CAM, _SIM_SDMMC + 13, struct _sdmmc_ra_stats)
+#define DCMD_SDMMC_PIPELINE_STATS		__DIOTF(_DCMD_CAM, _SIM_SDMMC + 14, struct _sdmmc_pipeline_stats)
 
 #include <_packpop.h>
 
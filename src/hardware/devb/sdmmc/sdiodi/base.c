@@ -792,7 +792,7 @@ int _sdio_set_block_length( sdio_dev_t *dev, int blklen )
 	return( status );
 }
 
-int _sdio_set_block_count( sdio_dev_t *dev, int blkcnt )
+int _sdio_set_block_count( sdio_dev_t *dev, uint32_t blkcnt )
 {
 	struct sdio_cmd		*cmd;
 	int					status;
@@ -1028,7 +1028,11 @@ int sdio_retune( sdio_hc_t *hc )
 
 	atomic_clr( &hc->flags, HC_FLAG_TUNE );
 
+		// a retune is requested by the timer, the hc or bus errors,
+		// so the last known good sampling point is not trusted
+	atomic_set( &hc->flags, HC_FLAG_TUNE_FULL );
 	sdio_tune( hc, hc->device.dtype == DEV_TYPE_MMC ? MMC_SEND_TUNING_BLOCK : SD_SEND_TUNING_BLOCK );
+	atomic_clr( &hc->flags, HC_FLAG_TUNE_FULL );
 
 	return( EOK );
 }
@@ -1060,6 +1064,9 @@ int sdio_wait_cmd( sdio_hc_t *hc, struct sdio_cmd *cmd, uint64_t tms )
 int sdio_issue_cmd( sdio_dev_t *dev, struct sdio_cmd *cmd, uint64_t tms )
 {
 	sdio_hc_t		*hc;
+	sdio_cmd_t		*ncmd;
+	uint64_t		cmplt;
+	uint64_t		ct;
 	int				status;
 
 	hc				= dev->hc;
@@ -1075,12 +1082,47 @@ int sdio_issue_cmd( sdio_dev_t *dev, struct sdio_cmd *cmd, uint64_t tms )
 	if( ( hc->flags & HC_FLAG_TUNE ) ) {
 		sdio_retune( hc );
 	}
+	else if( ( hc->flags & HC_FLAG_TUNE_CHECK ) ) {
+			// the hc reapplied a cached tuning result, a tuning block
+			// read confirms it and a failure falls back to a full retune
+		atomic_clr( &hc->flags, HC_FLAG_TUNE_CHECK );
+		sdio_tune( hc, hc->device.dtype == DEV_TYPE_MMC ? MMC_SEND_TUNING_BLOCK : SD_SEND_TUNING_BLOCK );
+	}
 
+		// only a data transfer starts the staging, so status polls, switches
+		// and the like issued before it leave the staged cmd in place
 	pthread_mutex_lock( &hc->mutex );
 	hc->wspc.cmd	= cmd;
+	ncmd			= NULL;
+	if( ( cmd->flags & SCF_DATA_MSK ) && hc->ncmd != cmd ) {
+		ncmd		= hc->ncmd;
+		hc->ncmd	= NULL;
+	}
+	else if( hc->ncmd == cmd ) {
+		hc->ncmd	= NULL;
+	}
+	cmplt			= hc->xfer_cmplt;
 	pthread_mutex_unlock( &hc->mutex );
 
 	if( ( status = hc->entry.cmd( hc, cmd ) ) == EOK ) {
+		if( ( cmd->flags & SCF_DATA_MSK ) ) {
+			ct = _syspage_time( CLOCK_MONOTONIC );
+			hc->xfers++;
+			if( hc->pcmd == cmd ) {
+				hc->xfer_preps++;
+			}
+			hc->pcmd = NULL;
+			if( cmplt && ct - cmplt < SDIO_XFER_GAP_MAX ) {
+				hc->xfer_gaps++;
+				hc->xfer_gap_ns += ct - cmplt;
+			}
+		}
+
+			// stage the next transfer while this one is on the bus
+		if( ncmd != NULL && hc->entry.prep ) {
+			hc->entry.prep( hc, ncmd );
+			hc->pcmd = ncmd;
+		}
 		status = sdio_wait_cmd( hc, cmd, tms );
 	}
 
@@ -1095,6 +1137,27 @@ int sdio_issue_cmd( sdio_dev_t *dev, struct sdio_cmd *cmd, uint64_t tms )
 	return( status );
 }
 
+// Record the command that will be issued after the active one so the hc
+// can do its DMA setup while the bus is busy.  A NULL cmd drops any
+// staged state, which must happen before a staged cmd is freed unissued.
+int _sdio_prep_cmd( sdio_dev_t *dev, struct sdio_cmd *cmd )
+{
+	sdio_hc_t		*hc;
+
+	hc				= dev->hc;
+
+	pthread_mutex_lock( &hc->mutex );
+	hc->ncmd		= cmd;
+	pthread_mutex_unlock( &hc->mutex );
+
+	if( cmd == NULL && hc->entry.prep ) {
+		hc->entry.prep( hc, NULL );
+		hc->pcmd	= NULL;
+	}
+
+	return( EOK );
+}
+
 // hc callback for command completion
 int sdio_cmd_cmplt( sdio_hc_t *hc, struct sdio_cmd *cmd, int status )
 {
@@ -1113,6 +1176,9 @@ int sdio_cmd_cmplt( sdio_hc_t *hc, struct sdio_cmd *cmd, int status )
 	pthread_mutex_lock( &hc->mutex );
 	hc->wspc.cmd	= NULL;
 	cmd->status		= status;
+	if( ( cmd->flags & SCF_DATA_MSK ) ) {
+		hc->xfer_cmplt = _syspage_time( CLOCK_MONOTONIC );
+	}
 	pthread_cond_signal( &hc->cond );
 	pthread_mutex_unlock( &hc->mutex );
 
@@ -1142,7 +1208,7 @@ int _sdio_send_cmd( sdio_dev_t *dev, struct sdio_cmd *cmd,
 		}
 
 		if( ( cmd->flags & SCF_SBC ) && !( hc->caps & HC_CAP_ACMD23 ) ) {
-			if( ( status = _sdio_set_block_count( dev, cmd->blks ) ) ) {
+			if( ( status = _sdio_set_block_count( dev, SDIO_SBC_ARG( cmd ) ) ) ) {
 				break;
 			}
 		}
@@ -1191,6 +1257,11 @@ int _sdio_bus_error( sdio_dev_t *dev )
 
 	sdio_slogf( _SLOGC_SDIODI, _SLOG_ERROR, hc->cfg.verbosity, 1, "%s:  ", __FUNCTION__ );
 
+		// CRC errors in a tuned mode first retune before the retry
+	if( ( dev->flags & ( DEV_FLAG_HS200 | DEV_FLAG_UHS ) ) && hc->entry.tune ) {
+		atomic_set( &hc->flags, HC_FLAG_TUNE );
+	}
+
 	if( ++hc->bus_errs > SDIO_MAX_BUS_ERRS ) {
 #if 0
 // only needed for testing when we simulate bus errors
@@ -201,6 +201,21 @@ int sdio_send_cmd( struct sdio_device *device, struct sdio_cmd *cmd,
 	return( status );
 }
 
+int sdio_prep_cmd( struct sdio_device *device, struct sdio_cmd *cmd )
+{
+	int				status;
+
+	if( ( status = _sdio_synchronize( device, !0, 1 ) ) != EOK ) {
+		return( status );
+	}
+
+	status = _sdio_prep_cmd( device->dev, cmd );
+
+	_sdio_synchronize( device, !0, -1 );
+
+	return( status );
+}
+
 int sdio_stop_transmission( struct sdio_device *device, int hpi )
 {
 	int				status;
@@ -294,6 +309,21 @@ int sdio_mmc_switch( struct sdio_device *device, uint32_t cmdset, uint32_t mode,
 	return( status );
 }
 
+int sdio_mmc_switch_nowait( struct sdio_device *device, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value )
+{
+	int				status;
+
+	if( ( status = _sdio_synchronize( device, !0, 1 ) ) != EOK ) {
+		return( status );
+	}
+
+	status = mmc_switch_nowait( device->dev, cmdset, mode, index, value );
+
+	_sdio_synchronize( device, !0, -1 );
+	
+	return( status );
+}
+
 int sdio_send_ext_csd( struct sdio_device *device, uint8_t *csd )
 {
 	int				status;
@@ -353,6 +383,10 @@ int sdio_hc_info( struct sdio_device *device, sdio_hc_info_t *info )
 	info->bus_width		= hc->bus_width;
 	info->idle_time		= hc->cfg.idle_time;
 	info->sleep_time	= hc->cfg.sleep_time;
+	info->xfers			= hc->xfers;
+	info->xfer_preps	= hc->xfer_preps;
+	info->xfer_gaps		= hc->xfer_gaps;
+	info->xfer_gap_ns	= hc->xfer_gap_ns;
 	strcpy( info->name, hc->cfg.name );
 
 	return( EOK );
@@ -406,6 +440,8 @@ int sdio_dev_info( struct sdio_device *device, sdio_dev_info_t *info )
 			info->sector_size		= ecsd->blksz;
 			info->super_page_size	= ecsd->acc_size;
 		}
+		info->cache_size		= ecsd->cache_size;
+		info->max_packed_writes	= ecsd->max_packed_wr;
 		info->spec_vers			= dev->csd.spec_vers;
 		info->spec_rev			= ecsd->ext_csd_rev;
 	}
@@ -437,6 +473,40 @@ int sdio_flush_cache( struct sdio_device *device )
 		return( status );
 	}
 
+	if( device->dev->dtype == DEV_TYPE_MMC ) {
+		status = mmc_flush_cache( device->dev );
+	}
+
+	_sdio_synchronize( device, !0, -1 );
+
+	return( status );
+}
+
+int sdio_cache( struct sdio_device *device, int enable )
+{
+	int				status;
+
+	if( ( status = _sdio_synchronize( device, !0, 1 ) ) != EOK ) {
+		return( status );
+	}
+
+	status = ( device->dev->dtype == DEV_TYPE_MMC ) ? mmc_cache( device->dev, enable ) : ENOTSUP;
+
+	_sdio_synchronize( device, !0, -1 );
+
+	return( status );
+}
+
+int sdio_hpi( struct sdio_device *device )
+{
+	int				status;
+
+	if( ( status = _sdio_synchronize( device, !0, 1 ) ) != EOK ) {
+		return( status );
+	}
+
+	status = ( device->dev->dtype == DEV_TYPE_MMC ) ? mmc_hpi( device->dev ) : ENOTSUP;
+
 	_sdio_synchronize( device, !0, -1 );
 
 	return( status );
@@ -20,6 +20,7 @@
  */
 
 #include <errno.h>
+#include <atomic.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -58,8 +59,11 @@ static int omap_event( sdio_hc_t *hc, sdio_event_t *ev );
 static int omap_tune( sdio_hc_t *hc, int op );
 static int omap_preset( sdio_hc_t *hc, int enable );
 static int omap_set_dll( sdio_hc_t *hc, int delay );
+static int omap_tune_lookup( sdio_hc_t *hc );
+static void omap_tune_apply( sdio_hc_t *hc, uint32_t pdelay );
+static int omap_prep( sdio_hc_t *hc, sdio_cmd_t *cmd );
 
-static sdio_hc_entry_t omap_hc_entry =	{ 16,
+static sdio_hc_entry_t omap_hc_entry =	{ 17,
 										omap_dinit, omap_pm,
 										omap_cmd, omap_abort,
 										omap_event, omap_cd, omap_pwr,
@@ -67,6 +71,7 @@ static sdio_hc_entry_t omap_hc_entry =	{ 16,
 										omap_bus_width, omap_timing,
 										omap_signal_voltage, omap_drv_type,
 										NULL, omap_tune, omap_preset,
+										omap_prep,
 										};
 
 //	EDMA is "Enhanced Direct Memory Access"
@@ -506,6 +511,7 @@ static int omap_restore_context( sdio_hc_t *hc )
 	uint32_t			capa;
 	uint32_t			hctl;
 	uintptr_t			base;
+	int					idx;
 
 	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
 	base	= mmchs->mmc_base;
@@ -556,6 +562,13 @@ static int omap_restore_context( sdio_hc_t *hc )
 		omap_drv_type( hc, hc->drv_type );
 		omap_timing( hc, hc->timing );
 		omap_clk( hc, hc->clk ? hc->clk : hc->clk_min );
+
+			// reselect the tuned sampling clock instead of a full retune,
+			// the next command confirms it with a tuning block read
+		if( mmchs->tuned && ( idx = omap_tune_lookup( hc ) ) != -1 ) {
+			omap_tune_apply( hc, mmchs->tcache[idx].pdelay );
+			atomic_set( &hc->flags, HC_FLAG_TUNE_CHECK );
+		}
 	}
 	return( EOK );
 }
@@ -934,20 +947,112 @@ static int omap_event( sdio_hc_t *hc, sdio_event_t *ev )
 	return( status );
 }
 
-static int omap_sdma_setup( sdio_hc_t *hc, sdio_cmd_t *cmd )
+// Translate the sgl and build the ADMA descriptor table for cmd in the
+// given slot.  Only memory is touched, so this is safe to run for the
+// next command while the active one is still on the bus.
+static int omap_dma_xlat( sdio_hc_t *hc, sdio_cmd_t *cmd, int slot )
 {
 	omap_hc_mmchs_t		*mmchs;
+	omap_adma32_t		*adma;
+	sdio_sge_t			*sgp;
+	int					sgi;
+	int					acnt;
+	int					alen;
+	int					sg_count;
+	paddr_t				paddr;
 
 	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
+	sgp		= cmd->sgl;
 
 	if( !( cmd->flags & SCF_DATA_PHYS ) ) {
-		sdio_vtop_sg( cmd->sgl, mmchs->sgl, cmd->sgc, cmd->mhdl );
-		mmchs->sgp = mmchs->sgl;
+		sdio_vtop_sg( cmd->sgl, mmchs->sgl[slot], cmd->sgc, cmd->mhdl );
+		sgp = mmchs->sgl[slot];
+	}
+
+	mmchs->sgs[slot] = sgp;
+
+	if( !( mmchs->flags & OF_USE_ADMA ) ) {
+		return( EOK );
+	}
+
+	// Count the descriptors first, the table of the other slot may be
+	// in use by the controller and must never be overrun.
+	for( sgi = 0, acnt = 0; sgi < cmd->sgc; sgi++ ) {
+		acnt += ( sgp[sgi].sg_count + ADMA2_MAX_XFER - 1 ) / ADMA2_MAX_XFER;
+	}
+	if( acnt == 0 || acnt > DMA_DESC_MAX ) {
+		return( ENOTSUP );
+	}
+
+	adma	= (omap_adma32_t *)mmchs->adma + slot * DMA_DESC_MAX;
+
+	for( sgi = 0; sgi < cmd->sgc; sgi++, sgp++ ) {
+		paddr		= sgp->sg_address;
+		sg_count	= sgp->sg_count;
+		while( sg_count ) {
+			alen		= min( sg_count, ADMA2_MAX_XFER );
+			adma->attr	= ADMA2_VALID | ADMA2_TRAN;
+			adma->addr	= paddr;
+			adma->len	= alen;
+			sg_count	-= alen;
+			paddr		+= alen;
+			adma++;
+		}
+	}
+
+	adma--;
+	adma->attr |= ADMA2_END;
+
+	return( EOK );
+}
+
+static int omap_prep( sdio_hc_t *hc, sdio_cmd_t *cmd )
+{
+	omap_hc_mmchs_t		*mmchs;
+
+	mmchs			= (omap_hc_mmchs_t *)hc->cs_hdl;
+	mmchs->pcmd		= NULL;
+
+	if( cmd == NULL || !( cmd->flags & SCF_DATA_MSK ) || !( hc->caps & HC_CAP_DMA ) ||
+			cmd->opcode == MMC_SEND_TUNING_BLOCK || cmd->opcode == SD_SEND_TUNING_BLOCK ) {
+		return( EOK );
+	}
+
+	mmchs->pstatus	= omap_dma_xlat( hc, cmd, mmchs->sgi ^ 1 );
+	mmchs->pcmd		= cmd;
+
+	return( mmchs->pstatus );
+}
+
+// Select the slot for cmd, using the prepared one when it matches.  Any
+// other transfer (e.g. an EXT_CSD read) goes through the current slot and
+// leaves the prepared one for the cmd it was built for.
+static int omap_dma_slot( sdio_hc_t *hc, sdio_cmd_t *cmd )
+{
+	omap_hc_mmchs_t		*mmchs;
+	int					status;
+
+	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
+
+	if( mmchs->pcmd == cmd ) {
+		mmchs->sgi	^= 1;
+		status		= mmchs->pstatus;
+		mmchs->pcmd	= NULL;
 	}
 	else {
-		mmchs->sgp = cmd->sgl;
+		status		= omap_dma_xlat( hc, cmd, mmchs->sgi );
 	}
 
+	return( status );
+}
+
+static int omap_sdma_setup( sdio_hc_t *hc, sdio_cmd_t *cmd )
+{
+	omap_hc_mmchs_t		*mmchs;
+
+	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
+
+	mmchs->sgp		= mmchs->sgs[mmchs->sgi];
 	mmchs->sgc		= cmd->sgc;
 
 	omap_sdma_xfer( hc, cmd->flags, cmd->blksz, mmchs->sgp );
@@ -959,14 +1064,7 @@ static int omap_edma_setup( sdio_hc_t *hc, sdio_cmd_t *cmd )
 {
 	omap_hc_mmchs_t* mmchs = (omap_hc_mmchs_t *)hc->cs_hdl;
 
-	if( !( cmd->flags & SCF_DATA_PHYS ) ) {
-		sdio_vtop_sg( cmd->sgl, mmchs->sgl, cmd->sgc, cmd->mhdl );
-		mmchs->sgp = mmchs->sgl;
-	}
-	else {
-		mmchs->sgp = cmd->sgl;
-	}
-
+	mmchs->sgp = mmchs->sgs[mmchs->sgi];
 	mmchs->sgc = cmd->sgc;
 
 	//	If the setup fails, return an error code to the caller.
@@ -987,51 +1085,15 @@ static int omap_edma_setup( sdio_hc_t *hc, sdio_cmd_t *cmd )
 static int omap_adma_setup( sdio_hc_t *hc, sdio_cmd_t *cmd )
 {
 	omap_hc_mmchs_t		*mmchs;
-	omap_adma32_t		*adma;
-	sdio_sge_t			*sgp;
-	int					sgc;
-	int					sgi;
-	int					acnt;
-	int					alen;
-	int					sg_count;
-	paddr_t				paddr;
 
 	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
-	adma	= (omap_adma32_t *)mmchs->adma;
-
-	sgc = cmd->sgc;
-	sgp = cmd->sgl;
-
-	if( !( cmd->flags & SCF_DATA_PHYS ) ) {
-		sdio_vtop_sg( sgp, mmchs->sgl, sgc, cmd->mhdl );
-		sgp = mmchs->sgl;
-	}
-
-	for( sgi = 0, acnt = 0; sgi < sgc; sgi++, sgp++ ) {
-		paddr		= sgp->sg_address;
-		sg_count	= sgp->sg_count;
-		while( sg_count ) {
-			alen		= min( sg_count, ADMA2_MAX_XFER );
-			adma->attr	= ADMA2_VALID | ADMA2_TRAN;
-			adma->addr	= paddr;
-			adma->len	= alen;
-			sg_count	-= alen;
-			paddr		+= alen;
-			adma++;
-			if( ++acnt > DMA_DESC_MAX ) {
-				return( ENOTSUP );
-			}
-		}
-	}
-
-	adma--;
-	adma->attr |= ADMA2_END;
 
 #ifdef SDIO_OMAP_BUS_SYNC
 	omap_bus_sync(hc);
 #endif
 
-	out32( mmchs->mmc_base + MMCHS_ADMASAL, mmchs->admap );
+	out32( mmchs->mmc_base + MMCHS_ADMASAL, mmchs->admap +
+			mmchs->sgi * DMA_DESC_MAX * sizeof( omap_adma32_t ) );
 
 	return( EOK );
 }
@@ -1067,15 +1129,19 @@ static int omap_xfer_setup( sdio_hc_t *hc, sdio_cmd_t *cmd, uint32_t *command, u
 		//	If the DMA setup fails, fall back to PIO.
 		//	This seemed to be the logic in the original code too.
 		if (use_dma) {
-			if( ( mmchs->flags & OF_USE_ADMA ) ) {
-				status = omap_adma_setup( hc, cmd );
-				*imask |= INTR_ADMAE;
-			}
-			else if (mmchs->flags & OF_USE_EDMA) {
-				status = omap_edma_setup( hc, cmd );
-			}
-			else {
-				status = omap_sdma_setup( hc, cmd );
+			//	The sgl translation is already done if the cmd was
+			//	prepared while the previous transfer was running.
+			if( ( status = omap_dma_slot( hc, cmd ) ) == EOK ) {
+				if( ( mmchs->flags & OF_USE_ADMA ) ) {
+					status = omap_adma_setup( hc, cmd );
+					*imask |= INTR_ADMAE;
+				}
+				else if (mmchs->flags & OF_USE_EDMA) {
+					status = omap_edma_setup( hc, cmd );
+				}
+				else {
+					status = omap_sdma_setup( hc, cmd );
+				}
 			}
 
 			if( status == EOK ) {
@@ -1108,7 +1174,7 @@ static int omap_xfer_setup( sdio_hc_t *hc, sdio_cmd_t *cmd, uint32_t *command, u
 			*command |= CMD_MBS | CMD_BCE;
 			if( ( hc->caps & HC_CAP_ACMD23 ) && ( cmd->flags & SCF_SBC ) ) {
 				*command |= CMD_ACMD23;
-				out32( mmchs->mmc_base + MMCHS_SDMASA, cmd->blks );
+				out32( mmchs->mmc_base + MMCHS_SDMASA, SDIO_SBC_ARG( cmd ) );
 			}
 			else if( ( hc->caps & HC_CAP_ACMD12 ) ) {
 				*command |= CMD_ACMD12;
@@ -1201,6 +1267,8 @@ static int omap_abort( sdio_hc_t *hc, sdio_cmd_t *cmd )
 
 	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
 
+	mmchs->pcmd = NULL;			// never carry prepared DMA across an error
+
 	if( ( mmchs->flags & OF_SDMA_ACTIVE ) ) {
 		omap_sdma_stop( hc );
 	}
@@ -1682,6 +1750,93 @@ static int omap_set_dll( sdio_hc_t *hc, int delay)
 	return ( EOK );
 }
 
+// Tuning results are kept per card (CID) and clock so re-initialization,
+// bus mode changes and resume reuse the last known good sampling point
+// after a single tuning block read confirms it.
+static int omap_tune_lookup( sdio_hc_t *hc )
+{
+	omap_hc_mmchs_t		*mmchs;
+	sdio_dev_t			*dev;
+	int					idx;
+
+	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
+	dev		= &hc->device;
+
+	for( idx = 0; idx < TUNE_CACHE_MAX; idx++ ) {
+		if( mmchs->tcache[idx].valid &&
+				mmchs->tcache[idx].mid == dev->cid.mid &&
+				mmchs->tcache[idx].psn == dev->cid.psn &&
+				mmchs->tcache[idx].clk == hc->clk &&
+				mmchs->tcache[idx].timing == hc->timing ) {
+			return( idx );
+		}
+	}
+
+	return( -1 );
+}
+
+static void omap_tune_store( sdio_hc_t *hc, uint32_t pdelay )
+{
+	omap_hc_mmchs_t		*mmchs;
+	sdio_dev_t			*dev;
+	int					idx;
+
+	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
+	dev		= &hc->device;
+
+	if( ( idx = omap_tune_lookup( hc ) ) == -1 ) {
+		idx					= mmchs->tcache_next;
+		mmchs->tcache_next	= ( idx + 1 ) % TUNE_CACHE_MAX;
+	}
+
+	mmchs->tcache[idx].mid		= dev->cid.mid;
+	mmchs->tcache[idx].psn		= dev->cid.psn;
+	mmchs->tcache[idx].clk		= hc->clk;
+	mmchs->tcache[idx].timing	= hc->timing;
+	mmchs->tcache[idx].pdelay	= pdelay;
+	mmchs->tcache[idx].valid	= 1;
+}
+
+// Select the tuned sampling clock with the given DLL phase delay
+static void omap_tune_apply( sdio_hc_t *hc, uint32_t pdelay )
+{
+	omap_hc_mmchs_t		*mmchs;
+
+	mmchs	= (omap_hc_mmchs_t *)hc->cs_hdl;
+
+		// reset data and command line before setting phase delay,
+		// according to OMAP5432 ES2.0 spec.
+	omap_reset( hc, SYSCTL_SRD );
+	omap_reset( hc, SYSCTL_SRC );
+	omap_set_dll( hc, pdelay );
+	out32( mmchs->mmc_base + MMCHS_HCTL2, in32( mmchs->mmc_base + MMCHS_HCTL2 ) | HCTL2_TUNED_CLK );
+	mmchs->pdelay	= pdelay;
+	mmchs->tuned	= 1;
+}
+
+// Read one tuning block and compare it with the reference pattern
+static int omap_tune_check( sdio_hc_t *hc, sdio_cmd_t *cmd, uint32_t *td, int tlen, int op )
+{
+	sdio_sge_t			sge;
+	int					status;
+
+	memset( td, 0, tlen );
+	sdio_setup_cmd( cmd, SCF_CTYPE_ADTC | SCF_RSP_R1, op, 0 );
+	sge.sg_count = tlen; sge.sg_address = (paddr_t)td;
+	sdio_setup_cmd_io( cmd, SCF_DIR_IN, 1, tlen, &sge, 1, NULL );
+
+	if( ( status = sdio_issue_cmd( &hc->device, cmd, MMCHS_TUNING_TIMEOUT ) ) ) {
+		return( status );
+	}
+
+	if( cmd->status != CS_CMD_CMP ||
+			memcmp( td, ( hc->bus_width == BUS_WIDTH_8 ) ? sdio_tbp_8bit : sdio_tbp_4bit, tlen ) ) {
+		return( EIO );
+	}
+
+	return( EOK );
+}
+
 static int omap_tune( sdio_hc_t *hc, int op )
 {
 	omap_hc_mmchs_t		*mmchs;
@@ -1694,6 +1849,7 @@ static int omap_tune( sdio_hc_t *hc, int op )
 	int					tlc;
 	int					tlen;
 	int					status;
+	int					idx;
 	int					index = 0xFF;
 	int					imax = 0;
 	int					wlen = 0;
@@ -1733,6 +1889,22 @@ static int omap_tune( sdio_hc_t *hc, int op )
 		return( ENOMEM );
 	}
 
+	if( !( hc->flags & HC_FLAG_TUNE_FULL ) && ( idx = omap_tune_lookup( hc ) ) != -1 ) {
+		if( omap_waitmask( hc, MMCHS_DLL, DLL_LOCK, DLL_LOCK, MMCHS_TUNING_TIMEOUT ) == EOK ) {
+			omap_tune_apply( hc, mmchs->tcache[idx].pdelay );
+			if( omap_tune_check( hc, cmd, td, tlen, op ) == EOK ) {
+				sdio_free( td, tlen );
+				sdio_free_cmd( cmd );
+				return( EOK );
+			}
+		}
+		sdio_slogf( _SLOGC_SDIODI, _SLOG_ERROR, hc->cfg.verbosity, 1, "%s: cached tuning 0x%x rejected", __FUNCTION__, mmchs->tcache[idx].pdelay );
+		mmchs->tcache[idx].valid = 0;
+		mmchs->tuned = 0;
+		hctl2 = in32( base + MMCHS_HCTL2 ) & ~HCTL2_TUNED_CLK;
+		out32( base + MMCHS_HCTL2, hctl2 );
+	}
+
 #ifdef OMAP_DEBUG
 	sdio_slogf( _SLOGC_SDIODI, _SLOG_ERROR, 1, 1, "%s: start tuning", __FUNCTION__ );
 #endif
@@ -1791,12 +1963,8 @@ static int omap_tune( sdio_hc_t *hc, int op )
 	if( !status && ( hctl2 & HCTL2_TUNED_CLK ) ) {
 			// tuning successful, set phase delay to the middle of the window
 		pdelay = 2 * (imax + (wmax >> 1));
-			// reset data and command line before setting phase delay,
-			// according to OMAP5432 ES2.0 spec.
-		omap_reset( hc, SYSCTL_SRD );
-		omap_reset( hc, SYSCTL_SRC );
-		omap_set_dll(hc, pdelay);
-		hc->tuning_count = pdelay;
+		omap_tune_apply( hc, pdelay );
+		omap_tune_store( hc, pdelay );
 #ifdef OMAP_DEBUG
 		sdio_slogf( _SLOGC_SDIODI, _SLOG_ERROR, 1, 1, "%s: tuning successful. Set dll 0x%x", __FUNCTION__, pdelay);
 #endif
@@ -1805,6 +1973,7 @@ static int omap_tune( sdio_hc_t *hc, int op )
 			// tuning failed
 		hctl2 &= ~( HCTL2_TUNED_CLK | HCTL2_EXEC_TUNING );
 		out32( base + MMCHS_HCTL2, hctl2 );
+		mmchs->tuned = 0;
 		status = EIO;
 #ifdef OMAP_DEBUG
 		sdio_slogf( _SLOGC_SDIODI, _SLOG_ERROR, 1, 1, "%s: tuning failed. status %d", __FUNCTION__, status);
@@ -1980,7 +2149,7 @@ int omap_dinit( sdio_hc_t *hc )
 	}
 
 	if( mmchs->adma ) {
-		munmap( mmchs->adma, sizeof( omap_adma32_t ) * DMA_DESC_MAX );
+		munmap( mmchs->adma, sizeof( omap_adma32_t ) * DMA_DESC_MAX * DMA_SLOTS );
 #ifdef SDIO_OMAP_BUS_SYNC
 		omap_so_dinit(hc);
 #endif
@@ -2276,7 +2445,7 @@ int omap_init( sdio_hc_t *hc )
 	if( ( hc->caps & HC_CAP_DMA ) ) {
 		if( hc->version > REV_SREV_V1 && ( cap & CAP_AD2S ) &&
 					( hwinfo & HWINFO_MADMA_EN ) ) {
-			if( ( mmchs->adma = mmap( NULL, sizeof( omap_adma32_t ) * DMA_DESC_MAX,
+			if( ( mmchs->adma = mmap( NULL, sizeof( omap_adma32_t ) * DMA_DESC_MAX * DMA_SLOTS,
 					PROT_READ | PROT_WRITE | PROT_NOCACHE,
 					MAP_PRIVATE | MAP_ANON | MAP_PHYS, NOFD, 0 ) ) == MAP_FAILED ) {
 				sdio_slogf( _SLOGC_SDIODI, _SLOG_ERROR, 1, 1, "%s: ADMA mmap %s", __FUNCTION__, strerror( errno ) );
@@ -345,6 +345,20 @@ typedef	struct _omap_mmchs {
 #define TUNING_MODE_3	0x2
 	uint32_t		tuning_mode;
 
+	uint32_t		pdelay;			// DLL phase delay in use
+	int				tuned;			// pdelay is selected
+
+#define TUNE_CACHE_MAX		4
+	struct {						// last known good tuning per card and clock
+		uint32_t	mid;
+		uint32_t	psn;
+		uint32_t	clk;
+		uint32_t	timing;
+		uint32_t	pdelay;
+		int			valid;			// 0 when unused or rejected
+	}				tcache[TUNE_CACHE_MAX];
+	int				tcache_next;	// entry replaced next
+
 	uintptr_t		mmc_base;
 	unsigned		mmc_pbase;
 
@@ -356,10 +370,16 @@ typedef	struct _omap_mmchs {
 	uint32_t		cs;
 
 #define DMA_DESC_MAX		256
-	sdio_sge_t		sgl[DMA_DESC_MAX];
+#define DMA_SLOTS			2			// active + prepared (pipelined) transfer
+	sdio_sge_t		sgl[DMA_SLOTS][DMA_DESC_MAX];
+	sdio_sge_t		*sgs[DMA_SLOTS];	// translated sgl per slot
+	int				sgi;				// slot of the active transfer
+
+	sdio_cmd_t		*pcmd;				// cmd prepared in slot sgi ^ 1
+	int				pstatus;			// prepare status of pcmd
 
 // adma specific
-	omap_adma32_t	*adma;
+	omap_adma32_t	*adma;				// DMA_SLOTS descriptor tables
 	uint32_t		admap;
 
 // sdma specific
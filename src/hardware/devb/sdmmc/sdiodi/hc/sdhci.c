@@ -469,7 +469,7 @@ static int sdhci_xfer_setup( sdio_hc_t *hc, sdio_cmd_t *cmd,
 		*command |= SDHCI_CMD_MBS | SDHCI_CMD_BCE;
 		if( ( hc->caps & HC_CAP_ACMD23 ) && ( cmd->flags & SCF_SBC ) ) {
 			*command |= SDHCI_CMD_ACMD23;
-			sdhci_out32( base + SDHCI_SDMA_ARG2, cmd->blks );
+			sdhci_out32( base + SDHCI_SDMA_ARG2, SDIO_SBC_ARG( cmd ) );
 		}
 		else if( ( hc->caps & HC_CAP_ACMD12 ) ) {
 			*command |= SDHCI_CMD_ACMD12;
@@ -163,6 +163,9 @@
 #define	MMC_WRITE_DAT_UNTIL_STOP	20
 #define MMC_SEND_TUNING_BLOCK		21
 #define MMC_SET_BLOCK_COUNT         23
+	#define MMC_SBC_REL_WR				(1 << 31)	// reliable write
+	#define MMC_SBC_PACKED				(1 << 30)	// packed command
+	#define MMC_SBC_BLKS_MSK			0xffff
 #define	MMC_WRITE_BLOCK				24
 #define	MMC_WRITE_MULTIPLE_BLOCK	25
 #define	MMC_PROGRAM_CID				26
@@ -218,6 +221,11 @@
 	#define ECSD_POWER_OFF_SHORT		0x02
 	#define ECSD_POWER_OFF_LONG			0x03
 
+#define ECSD_EXCEPTION_EVENTS_STATUS	54
+
+#define ECSD_EXCEPTION_EVENTS_CTRL	56
+	#define ECSD_EE_URGENT_BKOPS		0x01
+
 #define ECSD_USE_NATIVE_SECTOR		62
 	#define ECSD_USE_NATIVE_SECTOR_EN	0x01
 
@@ -251,6 +259,9 @@
 	#define ECSD_PS_ENH_ATTR_EN			0x02
 	#define ECSD_PS_PART_EN				0x01
 
+#define ECSD_HPI_MGMT				161
+	#define ECSD_HPI_MGMT_EN			0x01
+
 #define ECSD_BKOPS_EN				163  // Background operation enable
 	#define ECSD_BKOPS_ENABLE			1
 
@@ -358,6 +369,11 @@
 
 #define ECSD_POWER_OFF_LONG_TIME	247  // Power off long switch timeout
 
+#define ECSD_CACHE_SIZE				249  // Volatile cache size in KB (4 bytes)
+
+#define ECSD_MAX_PACKED_WRITES		500
+#define ECSD_MAX_PACKED_READS		501
+
 #define ECSD_BKOPS_SUPPORTED		502  // Background operation support
 	#define ECSD_BKOPS_SUP				1
 
@@ -367,6 +383,11 @@
 
 #define ECSD_S_CMD_SET				504
 
+// Packed command header (first block of a packed CMD25)
+#define MMC_PACKED_VERSION			0x01
+#define MMC_PACKED_RW_WRITE			0x02
+#define MMC_PACKED_HDR_SIZE			512
+
 #endif
 
 
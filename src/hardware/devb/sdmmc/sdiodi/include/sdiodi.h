@@ -144,6 +144,10 @@ struct _sdio_ecsd {
     _Uint8t			hc_wp_grp_size;
     _Uint8t			user_wp;
 	_Uint8t			part_config;
+
+	_Uint8t			max_packed_wr;		// packed write entries
+	_Uint8t			max_packed_rd;		// packed read entries
+	_Uint32t		cache_size;			// volatile cache in KB
 };
 
 struct _sdio_sge {
@@ -186,6 +190,7 @@ struct _sdio_sge {
 #define	SCF_AC12			(1 << 14)	// auto cmd 12
 #define	SCF_MULTIBLK		(1 << 15)
 #define	SCF_WAIT_DRDY		(1 << 16)	// wait ready for data
+#define	SCF_PACKED			(1 << 17)	// packed command (cmd 23 arg)
 
 // command status
 #define CS_CMD_INPROG		0x00
@@ -265,6 +270,7 @@ struct _sdio_dev_info {
 #define DEV_CAP_CACHE		(1 << 15)
 #define DEV_CAP_HS400		(1 << 16)
 #define DEV_CAP_PWROFF_NOTIFY	(1 << 17)	// Power off notify supported
+#define DEV_CAP_PACKED		(1 << 18)	// Packed commands supported
 	_Uint64t			caps;
 
 	_Uint32t			dtr;			// current data transfer rate
@@ -294,7 +300,10 @@ struct _sdio_dev_info {
 #define SPEED_CLASS_10	0x04
 	_Uint32t			speed_class;
 
-	_Uint32t			rsvd[15];
+	_Uint32t			cache_size;		// volatile cache size in KB
+	_Uint32t			max_packed_writes;
+
+	_Uint32t			rsvd[13];
 };
 
 struct _sdio_hc_info {
@@ -325,7 +334,11 @@ struct _sdio_hc_info {
 	_Uint32t		bus_width;					// Current Bus Width
 	_Uint32t		idle_time;					// PM Idle Time in ms
 	_Uint32t		sleep_time;					// PM Sleep Time in ms
-	_Uint32t		rsvd[10];
+	_Uint64t		xfers;						// data transfers started
+	_Uint64t		xfer_preps;					// of which prepared while the bus was busy
+	_Uint64t		xfer_gaps;					// back to back data transfers
+	_Uint64t		xfer_gap_ns;				// bus idle time between them
+	_Uint32t		rsvd[2];
 };
 
 struct _sdio_funcs {
@@ -375,6 +388,7 @@ extern int				sdio_cmd_status( struct sdio_cmd *cmd, _Uint32t *status, _Uint32t
 extern int				sdio_send_cmd( struct sdio_device *dev, struct sdio_cmd *cmd,
 							void (*func)( struct sdio_device *, struct sdio_cmd *, void *),
 							_Uint32t timeout, int retries );
+extern int				sdio_prep_cmd( struct sdio_device *dev, struct sdio_cmd *cmd );
 extern int				sdio_setup_cmd( struct sdio_cmd *cmd, _Uint32t flgs,
 							int op, int arg );
 extern int				sdio_setup_cmd_io( struct sdio_cmd *cmd, _Uint32t flgs,
@@ -391,10 +405,12 @@ extern void				*sdio_get_raw_ecsd( struct sdio_device *dev );
 extern void				*sdio_get_raw_scr( struct sdio_device *dev );
 extern int				sdio_sd_switch( struct sdio_device *device, int mode, int grp, uint8_t val, uint8_t *switch_status );
 extern int				sdio_mmc_switch( struct sdio_device *device, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value, uint32_t timeout );
+extern int				sdio_mmc_switch_nowait( struct sdio_device *device, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value );
 extern int				sdio_send_ext_csd( struct sdio_device *device, uint8_t *csd );
 extern int				sdio_hc_info( struct sdio_device *dev, sdio_hc_info_t *info );
 extern int				sdio_dev_info( struct sdio_device *device, sdio_dev_info_t *info );
 extern int				sdio_flush_cache( struct sdio_device *dev );
+extern int				sdio_cache( struct sdio_device *dev, int enable );
 extern int				sdio_set_partition( struct sdio_device *dev, _Uint32t partition );
 extern struct sdio_device *sdio_device_lookup( struct sdio_connection *connection,
 							sdio_device_instance_t *instance );
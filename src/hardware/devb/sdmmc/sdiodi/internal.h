@@ -142,6 +142,9 @@ struct sdio_cmd {
 	void					(*cbf)( struct sdio_device *, sdio_cmd_t *, void *);
 };
 
+	// set block count (cmd 23) argument of a command
+#define SDIO_SBC_ARG( _c )	( (_c)->blks | ( ( (_c)->flags & SCF_PACKED ) ? MMC_SBC_PACKED : 0 ) )
+
 struct _sdio_wspc {
 	sdio_cmd_t			*cmd;		// active command
 	sdio_sge_t			*sge;
@@ -209,6 +212,8 @@ struct _sdio_hc_entry {
 	int			(*driver_strength)(sdio_hc_t *, int timing, int type);
 	int			(*tune)(sdio_hc_t *, int op);
 	int			(*preset)(sdio_hc_t *, int);
+						// stage DMA for the next cmd while the bus is busy (NULL cmd drops it)
+	int			(*prep)(sdio_hc_t *, sdio_cmd_t *);
 };
 
 struct _sdio_dev {
@@ -230,6 +235,7 @@ struct _sdio_dev {
 #define DEV_FLAG_BKOPS			0x800		// BKOPS
 #define DEV_FLAG_SIG_ERR		0x1000		// signal switch error
 #define DEV_FLAG_WRITE_PROTECT	0x2000		// write protected
+#define DEV_FLAG_CACHE			0x4000		// volatile cache enabled
 	_Uint32t				flags;
 
 	_Uint32t				rsettle;
@@ -344,6 +350,8 @@ struct _sdio_hc {							// Host Controller
 #define	HC_FLAG_DEV_MMC				( 1 << 5 )
 #define	HC_FLAG_DEV_SDIO			( 1 << 6 )
 #define	HC_FLAG_DEV_TYPE			( HC_FLAG_DEV_SD | HC_FLAG_DEV_MMC | HC_FLAG_DEV_SDIO )
+#define	HC_FLAG_TUNE_FULL			( 1 << 7 )	// retune, don't reuse a previous result
+#define	HC_FLAG_TUNE_CHECK			( 1 << 8 )	// confirm a reapplied tuning result
 	_Uint32t			flags;
 
 #define	HC_CAP_SLOT_TYPE_EMBEDDED	(1 << 0)	// embedded card
@@ -416,6 +424,17 @@ struct _sdio_hc {							// Host Controller
 	void				*phdl;				// pci_attach_device handle
 
 	sdio_wspc_t			wspc;				// data xfer workspc
+	sdio_cmd_t			*ncmd;				// next cmd, prepared while wspc.cmd is active
+	sdio_cmd_t			*pcmd;				// cmd handed to entry.prep
+
+		// bus idle time between back to back data transfers, from the
+		// completion of one to the start of the next
+#define SDIO_XFER_GAP_MAX			1000000		// ns, longer gaps are idle time
+	_Uint64t			xfer_cmplt;			// last data transfer completion
+	_Uint64t			xfers;				// data transfers started
+	_Uint64t			xfer_preps;			// of which handed to entry.prep ahead
+	_Uint64t			xfer_gaps;
+	_Uint64t			xfer_gap_ns;
 
 	_Uint32t			clk_min;
 	_Uint32t			clk_max;
@@ -546,12 +565,13 @@ extern int sdio_select_voltage( sdio_hc_t *hc, int ocr );
 extern int sdio_signal_voltage( sdio_hc_t *hc, int voltage );
 extern int sdio_wait_cmd( sdio_hc_t *hc, struct sdio_cmd *cmd, uint64_t tms );
 extern int sdio_issue_cmd( sdio_dev_t *dev, struct sdio_cmd *cmd, uint64_t tms );
+extern int _sdio_prep_cmd( sdio_dev_t *dev, struct sdio_cmd *cmd );
 
 extern int _sdio_disconnect( );
 extern int _sdio_reset( sdio_dev_t *dev );
 extern int _sdio_bus_error( sdio_dev_t *dev );
 extern int _sdio_pwrmgnt( sdio_dev_t *dev, int pm );
-extern int _sdio_set_block_count( sdio_dev_t *dev, int blkcnt );
+extern int _sdio_set_block_count( sdio_dev_t *dev, uint32_t blkcnt );
 extern int _sdio_set_block_length( sdio_dev_t *dev, int blklen );
 extern int _sdio_stop_transmission( sdio_dev_t *dev, int hpi );
 extern int _sdio_send_status( sdio_dev_t *dev, uint32_t *rsp, int hpi );
@@ -579,6 +599,10 @@ extern uint64_t mmc_erase_timeout( sdio_dev_t *dev, uint32_t etype, uint64_t nlb
 extern int mmc_erase( sdio_dev_t *dev, int partition, int flgs, uint64_t lba, int nlba );
 extern int mmc_write_protect( sdio_dev_t *dev, int op, int ptype, int mode, uint32_t lba, uint32_t nlba );
 extern int mmc_switch( sdio_dev_t *dev, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value, uint32_t timeout );
+extern int mmc_switch_nowait( sdio_dev_t *dev, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value );
+extern int mmc_cache( sdio_dev_t *dev, int enable );
+extern int mmc_flush_cache( sdio_dev_t *dev );
+extern int mmc_hpi( sdio_dev_t *dev );
 // mmc.c end
 
 // sd.c
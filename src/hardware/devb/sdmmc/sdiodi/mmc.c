@@ -252,6 +252,10 @@ int mmc_parse_ext_csd( sdio_dev_t *dev, sdio_ecsd_t *ecsd, uint8_t *raw_ecsd )
 		}
 
 		// HPI
+		if( ( raw_ecsd[ECSD_HPI_FEATURES] & EXT_HPI_FEATURES_SUPPORTED ) ) {
+			dev->caps	|= ( raw_ecsd[ECSD_HPI_FEATURES] & EXT_HPI_FEATURES_SUP_CMD12 ) ?
+								DEV_CAP_HPI_CMD12 : DEV_CAP_HPI_CMD13;
+		}
 
 		// MDT handle 2012 roll over
 		if( dev->cid.year < MDT_YEAR_2010 ) {
@@ -263,8 +267,26 @@ int mmc_parse_ext_csd( sdio_dev_t *dev, sdio_ecsd_t *ecsd, uint8_t *raw_ecsd )
 		// HS200
 		// context management
 		// packed commands
+		if( raw_ecsd[ECSD_MAX_PACKED_WRITES] ) {
+			ecsd->max_packed_wr	= raw_ecsd[ECSD_MAX_PACKED_WRITES];
+			ecsd->max_packed_rd	= raw_ecsd[ECSD_MAX_PACKED_READS];
+			dev->caps			|= DEV_CAP_PACKED;
+		}
+
 		// exception events
+
 		// cache
+		ecsd->cache_size =	raw_ecsd[ECSD_CACHE_SIZE + 0] << 0 |
+							raw_ecsd[ECSD_CACHE_SIZE + 1] << 8 |
+							raw_ecsd[ECSD_CACHE_SIZE + 2] << 16 |
+							raw_ecsd[ECSD_CACHE_SIZE + 3] << 24;
+		if( ecsd->cache_size ) {
+			dev->caps	|= DEV_CAP_CACHE;
+			if( ( raw_ecsd[ECSD_CACHE_CTRL] & ECSD_CACHE_CTRL_EN ) ) {
+				dev->flags	|= DEV_FLAG_CACHE;
+			}
+		}
+
 		// dynamic capacity management
 		// large sector size
 		// power off notification
@@ -355,7 +377,7 @@ uint64_t mmc_erase_grp_size( sdio_dev_t *dev )
 	return( erase_grp_size );
 }
 
-int mmc_switch( sdio_dev_t *dev, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value, uint32_t timeout )
+static int _mmc_switch( sdio_dev_t *dev, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value, uint32_t timeout, int busy )
 {
 	sdio_cmd_t		*cmd;
 	int				status;
@@ -364,10 +386,10 @@ int mmc_switch( sdio_dev_t *dev, uint32_t cmdset, uint32_t mode, uint32_t index,
 		return( ENOMEM );
 	}
 
-	sdio_setup_cmd( cmd, SCF_CTYPE_AC | SCF_RSP_R1B, MMC_SWITCH,
+	sdio_setup_cmd( cmd, SCF_CTYPE_AC | ( busy ? SCF_RSP_R1B : SCF_RSP_R1 ), MMC_SWITCH,
 			( mode << 24 ) | ( index << 16 ) | ( value << 8 ) | cmdset );
 
-	if( ( status = _sdio_send_cmd( dev, cmd, NULL, SDIO_TIME_DEFAULT, SDIO_CMD_RETRIES ) ) == EOK ) {
+	if( ( status = _sdio_send_cmd( dev, cmd, NULL, SDIO_TIME_DEFAULT, SDIO_CMD_RETRIES ) ) == EOK && busy ) {
 			// SanDisk errata.  The parts can't handle
 			// commands within 100us after the switch.
 //		nanospin_ns( 500000L );
@@ -381,6 +403,83 @@ int mmc_switch( sdio_dev_t *dev, uint32_t cmdset, uint32_t mode, uint32_t index,
 	return( status );
 }
 
+int mmc_switch( sdio_dev_t *dev, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value, uint32_t timeout )
+{
+	return( _mmc_switch( dev, cmdset, mode, index, value, timeout, 1 ) );
+}
+
+// Switch with an R1 response, the device is left busy (ie BKOPS) until the
+// operation completes or is interrupted by HPI.
+int mmc_switch_nowait( sdio_dev_t *dev, uint32_t cmdset, uint32_t mode, uint32_t index, uint32_t value )
+{
+	return( _mmc_switch( dev, cmdset, mode, index, value, 0, 0 ) );
+}
+
+int mmc_cache( sdio_dev_t *dev, int enable )
+{
+	int		status;
+
+	if( !( dev->caps & DEV_CAP_CACHE ) ) {
+		return( ENOTSUP );
+	}
+
+	if( !enable && ( status = mmc_flush_cache( dev ) ) != EOK ) {
+		return( status );
+	}
+
+	if( ( status = mmc_switch( dev, MMC_SWITCH_CMDSET_DFLT, MMC_SWITCH_MODE_WRITE, ECSD_CACHE_CTRL, enable ? ECSD_CACHE_CTRL_EN : 0, SDIO_TIME_DEFAULT ) ) == EOK ) {
+		if( enable ) {
+			dev->flags |= DEV_FLAG_CACHE;
+		}
+		else {
+			dev->flags &= ~DEV_FLAG_CACHE;
+		}
+	}
+
+	return( status );
+}
+
+int mmc_flush_cache( sdio_dev_t *dev )
+{
+	if( !( dev->flags & DEV_FLAG_CACHE ) ) {
+		return( EOK );
+	}
+
+	return( mmc_switch( dev, MMC_SWITCH_CMDSET_DFLT, MMC_SWITCH_MODE_WRITE, ECSD_FLUSH_CACHE, ECSD_FLUSH_TRIGGER, SDIO_TIME_DEFAULT ) );
+}
+
+// High Priority Interrupt, bring a busy device back to the transfer state
+int mmc_hpi( sdio_dev_t *dev )
+{
+	uint32_t	rsp[4];
+	int			status;
+
+	if( !( dev->caps & ( DEV_CAP_HPI_CMD12 | DEV_CAP_HPI_CMD13 ) ) ) {
+		return( ENOTSUP );
+	}
+
+	if( ( status = _sdio_send_status( dev, rsp, SDIO_FALSE ) ) != EOK ) {
+		return( status );
+	}
+
+	if( ( rsp[0] & CDS_CUR_STATE_MSK ) != CDS_CUR_STATE_PRG ) {
+		return( EOK );
+	}
+
+	if( ( dev->caps & DEV_CAP_HPI_CMD12 ) ) {
+		status = _sdio_stop_transmission( dev, SDIO_TRUE );
+	}
+	else {
+		status = _sdio_send_status( dev, rsp, SDIO_TRUE );
+	}
+
+	if( status == EOK ) {
+		status = _sdio_wait_card_status( dev, rsp, CDS_READY_FOR_DATA | CDS_CUR_STATE_MSK, CDS_READY_FOR_DATA | CDS_CUR_STATE_TRAN, SDIO_TIME_DEFAULT );
+	}
+
+	return( status );
+}
+
 int mmc_set_partition( sdio_dev_t *dev, uint32_t partition )
 {
 	int		status;
@@ -166,6 +166,7 @@ SIM_HBA *sdmmc_alloc_hba( )
 	ext->ntargs			= 0;
 	ext->priority		= SDMMC_SCHED_PRIORITY;
 	ext->pm_timerid		= -1;
+	ext->bkops_idle_ns	= SDMMC_TIMEOUT_MS_TO_NS( SDMMC_BKOPS_IDLE );
 
 	ext->assd_active_sec_sys = -1;
 
@@ -272,6 +273,7 @@ int sdmmc_partition_config( SIM_HBA *hba )
 
 	nlba			= ext->dev_inf.sectors;
 	blksz			= ext->dev_inf.sector_size;
+	ext->ra_nlba	= 0;
 
 	for( tidx = 0; tidx < SDMMC_TARGET_MAX; tidx++ ) {
 		targ 			= &ext->targets[tidx];
@@ -402,11 +404,24 @@ void sdmmc_display_ccb( SIM_HBA *hba, CCB *ccb_ptr )
 int sdmmc_detach( SIM_HBA *hba )
 {
 	SIM_SDMMC_EXT	*ext;
+	int				idx;
 
 	ext		= (SIM_SDMMC_EXT *)hba->ext;
 
 //	cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s:  hba %p", __FUNCTION__, hba );
 
+	if( ( ext->eflags & SDMMC_EFLAG_BKOPS_BUSY ) ) {
+		sdmmc_bkops_hpi( hba );
+	}
+
+	if( ext->ndq && ( ext->eflags & SDMMC_EFLAG_PRESENT ) ) {
+		sdmmc_discard_flush( hba );
+	}
+
+	if( ( ext->eflags & SDMMC_EFLAG_CACHE ) ) {
+		sdio_flush_cache( ext->device );
+	}
+
 	if( ( ext->eflags & SDMMC_EFLAG_PWROFF_NOTIFY ) ) {
 		sdmmc_pwroff_notify( hba, ext->pwroff_notify );
 	}
@@ -433,6 +448,7 @@ int sdmmc_detach( SIM_HBA *hba )
 	}
 
 	if( hba->simq ) {
+		sdmmc_pipeline_flush( hba, CAM_TRUE );
 		simq_dinit( hba->simq );
 	}
 
@@ -446,6 +462,20 @@ int sdmmc_detach( SIM_HBA *hba )
 	}
 #endif
 
+	if( ext->pk_hdr ) {
+		xpt_free( ext->pk_hdr, SDMMC_PACKED_HDR_BSIZE );
+	}
+
+	if( ext->ra_buf ) {
+		xpt_free( ext->ra_buf, ext->ra_max );
+	}
+
+	for( idx = 0; idx < SDMMC_RA_MAPS; idx++ ) {
+		if( ext->ra_map[idx].vaddr ) {
+			munmap( ext->ra_map[idx].vaddr, SDMMC_RA_MAP_SIZE );
+		}
+	}
+
 	sdmmc_free_hba( hba );
 
 	return( CAM_SUCCESS );
@@ -523,6 +553,31 @@ int sdmmc_attach( SIM_HBA *hba, struct sdio_connection *connection, sdio_device_
 			}
 		}
 
+		if( ( ext->eflags & SDMMC_EFLAG_CACHE ) ) {
+			if( sdio_cache( ext->device, CAM_TRUE ) != EOK ) {
+				cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: cache enable failure", __FUNCTION__ );
+				ext->eflags &= ~SDMMC_EFLAG_CACHE;
+			}
+		}
+
+		if( ( ext->eflags & SDMMC_EFLAG_HPI ) ) {
+			if( !( ext->eflags & SDMMC_EFLAG_BKOPS ) || sdmmc_hpi_cfg( hba ) != EOK ) {
+				ext->eflags &= ~SDMMC_EFLAG_HPI;
+			}
+		}
+
+		if( ( ext->eflags & SDMMC_EFLAG_PACKED ) ) {
+			if( sdmmc_packed_cfg( hba ) != EOK ) {
+				ext->eflags &= ~SDMMC_EFLAG_PACKED;
+			}
+		}
+
+		if( ext->ra_max ) {
+			if( sdmmc_ra_cfg( hba ) != EOK ) {
+				ext->ra_max = 0;
+			}
+		}
+
 		if( ( ext->dev_inf.caps & DEV_CAP_ASSD ) ) {
 			sdmmc_assd_init( hba );
 		}
@@ -891,6 +946,154 @@ int sdmmc_capacity( SIM_HBA *hba, CCB_SCSIIO *ccb )
 	return( status );
 }
 
+// Drop the read-ahead cache if it holds any of the blocks given.
+static void sdmmc_ra_inval( SIM_HBA *hba, uint32_t config, uint64_t lba, uint32_t nlba )
+{
+	SIM_SDMMC_EXT	*ext;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+
+	if( ext->ra_nlba && ext->ra_config == config &&
+			lba < (uint64_t)ext->ra_lba + ext->ra_nlba && lba + nlba > ext->ra_lba ) {
+		ext->ra_nlba = 0;
+		ext->ra_invals++;
+	}
+}
+
+// Issue the queued discard ranges, trimmed to the device trim granularity.
+// Fragments smaller than a granule are dropped, TRIM/DISCARD being hints.
+int sdmmc_discard_flush( SIM_HBA *hba )
+{
+	SIM_SDMMC_EXT	*ext;
+	SDMMC_DISCARD	*dq;
+	uint32_t		gran;
+	uint64_t		slba;
+	uint64_t		elba;
+	int				idx;
+	int				status;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	gran	= max( 1, ext->dev_inf.optimal_trim_size / ext->dev_inf.sector_size );
+	status	= EOK;
+
+	for( idx = 0; idx < ext->ndq; idx++ ) {
+		dq		= &ext->dq[idx];
+		slba	= ( ( (uint64_t)dq->lba + gran - 1 ) / gran ) * gran;
+		elba	= ( ( (uint64_t)dq->lba + dq->nlba ) / gran ) * gran;
+		if( elba <= slba ) {
+			continue;
+		}
+
+		if( ( status = sdio_erase( ext->device, dq->config, dq->dtype, slba, elba - slba ) ) != EOK ) {
+			cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: erase failure %d, lba %lld, nlba %lld",
+					__FUNCTION__, status, slba, elba - slba );
+			if( status == ENXIO ) {			// card has been removed
+				break;
+			}
+		}
+	}
+
+	ext->ndq		= 0;
+	ext->dq_nlba	= 0;
+
+	return( status );
+}
+
+// Queue a discard range, merging it with the queued ranges it overlaps or
+// adjoins.  Queued ranges never touch each other, so one pass is enough.
+static int sdmmc_discard_queue( SIM_HBA *hba, uint32_t config, int dtype, uint64_t lba, uint32_t nlba )
+{
+	SIM_SDMMC_EXT	*ext;
+	SDMMC_DISCARD	*dq;
+	uint64_t		elba;
+	int				idx;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	elba	= lba + nlba;
+
+	for( idx = 0; idx < ext->ndq; idx++ ) {
+		dq = &ext->dq[idx];
+		if( dq->config != config || dq->dtype != dtype ||
+				lba > (uint64_t)dq->lba + dq->nlba || elba < dq->lba ) {
+			continue;
+		}
+		lba				= min( lba, dq->lba );
+		elba			= max( elba, (uint64_t)dq->lba + dq->nlba );
+		ext->dq_nlba	-= dq->nlba;
+		*dq				= ext->dq[--ext->ndq];
+		idx--;
+	}
+
+	if( ext->ndq == SDMMC_DISCARD_MAX || elba - lba > SDMMC_DISCARD_NLBA ) {
+		sdmmc_discard_flush( hba );
+		if( elba - lba > SDMMC_DISCARD_NLBA ) {
+			return( sdio_erase( ext->device, config, dtype, lba, elba - lba ) );
+		}
+	}
+
+	dq				= &ext->dq[ext->ndq++];
+	dq->config		= config;
+	dq->dtype		= dtype;
+	dq->lba			= lba;
+	dq->nlba		= elba - lba;
+	ext->dq_nlba	+= dq->nlba;
+
+	if( ext->dq_nlba >= SDMMC_DISCARD_NLBA ) {
+		return( sdmmc_discard_flush( hba ) );
+	}
+
+	return( EOK );
+}
+
+// Remove the sectors about to be written from the queued discard ranges.
+// No commands are issued; if a split finds the queue full the upper piece
+// is dropped.
+static void sdmmc_discard_clip( SIM_HBA *hba, uint32_t config, uint64_t lba, uint32_t nlba )
+{
+	SIM_SDMMC_EXT	*ext;
+	SDMMC_DISCARD	*dq;
+	uint64_t		elba;
+	uint64_t		dlba;
+	uint64_t		delba;
+	int				idx;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	elba	= lba + nlba;
+
+	for( idx = 0; idx < ext->ndq; idx++ ) {
+		dq		= &ext->dq[idx];
+		dlba	= dq->lba;
+		delba	= dlba + dq->nlba;
+		if( dq->config != config || lba >= delba || elba <= dlba ) {
+			continue;
+		}
+
+		ext->dq_nlba -= dq->nlba;
+		if( lba <= dlba && elba >= delba ) {			// covered
+			*dq = ext->dq[--ext->ndq];
+			idx--;
+			continue;
+		}
+
+		if( lba > dlba && elba < delba && ext->ndq < SDMMC_DISCARD_MAX ) {
+			ext->dq[ext->ndq]		= *dq;				// upper piece
+			ext->dq[ext->ndq].lba	= elba;
+			ext->dq[ext->ndq].nlba	= delba - elba;
+			ext->dq_nlba			+= delba - elba;
+			ext->ndq++;
+		}
+
+		if( lba > dlba ) {								// keep lower piece
+			dq->nlba	= lba - dlba;
+		}
+		else {
+			dq->lba		= elba;
+			dq->nlba	= delba - elba;
+		}
+		ext->dq_nlba += dq->nlba;
+	}
+}
+
 int sdmmc_write_same( SIM_HBA *hba, CCB_SCSIIO *ccb )
 {
 	SIM_SDMMC_EXT	*ext;
@@ -913,7 +1116,15 @@ int sdmmc_write_same( SIM_HBA *hba, CCB_SCSIIO *ccb )
 	}
 
 	if( !( ext->dev_inf.caps & DEV_CAP_TRIM ) || !( cdb->write_same16.opt & WS_OPT_UNMAP ) ) {
-		status = sdmmc_error( hba, ccb, EINVAL );
+		return( sdmmc_error( hba, ccb, EINVAL ) );
+	}
+
+	sdmmc_ra_inval( hba, part->config, lba, nlba );
+
+	if( ( ext->eflags & SDMMC_EFLAG_DISCARD ) ) {
+		if( ( status = sdmmc_discard_queue( hba, part->config, MMC_ERASE_TRIM, lba, nlba ) ) ) {
+			status = sdmmc_error( hba, ccb, status );
+		}
 	}
 	else if( ( status = sdio_erase( ext->device, part->config, MMC_ERASE_TRIM, lba, nlba ) ) ) {
 		status = sdmmc_error( hba, ccb, status );
@@ -952,8 +1163,11 @@ int sdmmc_erase12( SIM_HBA *hba, CCB_SCSIIO *ccb )
 				( lba % egs ) || ( nlba % egs ) ) {
 			status = sdmmc_error( hba, ccb, EINVAL );
 		}
-		else if( ( status = sdio_erase( ext->device, part->config, MMC_ERASE_SECURE, lba, nlba ) ) ) {
-			status = sdmmc_error( hba, ccb, status );
+		else {
+			sdmmc_ra_inval( hba, part->config, lba, nlba );
+			if( ( status = sdio_erase( ext->device, part->config, MMC_ERASE_SECURE, lba, nlba ) ) ) {
+				status = sdmmc_error( hba, ccb, status );
+			}
 		}
 	}
 
@@ -972,6 +1186,9 @@ int sdmmc_sync( SIM_HBA *hba, CCB_SCSIIO *ccb )
 	ext		= (SIM_SDMMC_EXT *)hba->ext;
 
 	if( ( status = sdmmc_unit_ready( hba, ccb ) ) == CAM_REQ_CMP ) {
+		if( ext->ndq ) {
+			sdmmc_discard_flush( hba );
+		}
 		if( ( status = sdio_flush_cache( ext->device ) ) != EOK ) {
 			status = sdmmc_error( hba, ccb, status );
 		}
@@ -1107,15 +1324,84 @@ int sdmmc_bkops_cfg( SIM_HBA *hba )
 
 	if( ( status = sdio_mmc_switch( ext->device, MMC_SWITCH_CMDSET_DFLT, MMC_SWITCH_MODE_WRITE, ECSD_BKOPS_EN, ECSD_BKOPS_ENABLE, SDIO_TIME_DEFAULT ) ) != EOK ) {
 		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: switch ext_csd_bkops_en", __FUNCTION__ );
+		return( status );
+	}
+
+		// v4.5 devices only flag urgent BKOPS in R1 with the exception enabled
+	if( ext->dev_inf.spec_rev >= ECSD_REV_V4_5 ) {
+		if( sdio_mmc_switch( ext->device, MMC_SWITCH_CMDSET_DFLT, MMC_SWITCH_MODE_WRITE, ECSD_EXCEPTION_EVENTS_CTRL, ECSD_EE_URGENT_BKOPS, SDIO_TIME_DEFAULT ) != EOK ) {
+			cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: switch ext_csd_exception_events_ctrl", __FUNCTION__ );
+		}
+	}
+
+	return( status );
+}
+
+int sdmmc_hpi_cfg( SIM_HBA *hba )
+{
+	SIM_SDMMC_EXT	*ext;
+	int				status;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+
+	if( !( ext->dev_inf.caps & ( DEV_CAP_HPI_CMD12 | DEV_CAP_HPI_CMD13 ) ) ) {
+		return( ENOTSUP );
+	}
+
+	if( ( status = sdio_mmc_switch( ext->device, MMC_SWITCH_CMDSET_DFLT, MMC_SWITCH_MODE_WRITE, ECSD_HPI_MGMT, ECSD_HPI_MGMT_EN, SDIO_TIME_DEFAULT ) ) != EOK ) {
+		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: switch ext_csd_hpi_mgmt", __FUNCTION__ );
 	}
 
 	return( status );
 }
 
+static uint64_t sdmmc_nsec( void )
+{
+	struct timespec	ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return( timespec2nsec( &ts ) );
+}
+
+// Interrupt background operations left running by sdmmc_bkops()
+int sdmmc_bkops_hpi( SIM_HBA *hba )
+{
+	SIM_SDMMC_EXT	*ext;
+	uint32_t		rsp[4];
+	int				status;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+
+	ext->eflags			&= ~SDMMC_EFLAG_BKOPS_BUSY;
+	ext->bkops_time_ns	+= sdmmc_nsec( ) - ext->bkops_start;
+
+	if( ( status = sdio_send_status( ext->device, rsp, 0 ) ) != EOK ||
+			( rsp[0] & CDS_CUR_STATE_MSK ) != CDS_CUR_STATE_PRG ) {
+		return( status );					// already complete
+	}
+
+	ext->bkops_preempts++;
+
+	if( ( status = sdio_hpi( ext->device ) ) != EOK ) {
+		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: HPI failure %d", __FUNCTION__, status );
+	}
+
+	return( status );
+}
+
+// Background operations are started from the timer tick once the device
+// has been idle for bkops_idle, checking BKOPS_STATUS once per idle period.
+// Urgent levels are reported by the exception event bit in R1 responses,
+// which triggers the EXT_CSD read and a blocking BKOPS before the next I/O.
 int sdmmc_bkops( SIM_HBA *hba, int tick )
 {
 	SIM_SDMMC_EXT	*ext;
 	uint8_t			ecsd[MMC_EXT_CSD_SIZE];
+	uint32_t		rsp[4];
+	uint64_t		nsec;
+	int				nowait;
+	int				status;
 
 	ext		= (SIM_SDMMC_EXT *)hba->ext;
 
@@ -1123,50 +1409,125 @@ int sdmmc_bkops( SIM_HBA *hba, int tick )
 		return( EOK );
 	}
 
-	if( tick ) {							// Timer event, poll status
+	nsec = sdmmc_nsec( );
+
+	if( tick ) {							// Timer event
+		if( ( ext->eflags & SDMMC_EFLAG_BKOPS_BUSY ) ) {
+			if( sdio_send_status( ext->device, rsp, 0 ) == EOK &&
+					( rsp[0] & CDS_CUR_STATE_MSK ) == CDS_CUR_STATE_PRG ) {
+				return( EOK );				// still busy
+			}
+			ext->eflags			&= ~SDMMC_EFLAG_BKOPS_BUSY;
+			ext->bkops_time_ns	+= nsec - ext->bkops_start;
+			ext->bkops_idle_chk	= 0;		// device may want more
+		}
+
+		if( nsec < ext->pm_timestamp + ext->bkops_idle_ns ||
+				ext->bkops_idle_chk == ext->pm_timestamp ) {
+			return( EOK );
+		}
+
+		ext->bkops_idle_chk = ext->pm_timestamp;
 		sdmmc_pm( hba, PM_ACTIVE );
+	}
+	else if( !( ext->eflags & SDMMC_EFLAG_BKOPS_EE ) ) {
+		return( EOK );
+	}
+
+	ext->eflags &= ~SDMMC_EFLAG_BKOPS_EE;
+
+	if( sdio_send_ext_csd( ext->device, ecsd ) != EOK ) {
+		return( EOK );
+	}
+
+	ext->bkops_status = ecsd[ECSD_BKOPS_STATUS] & BKOPS_STATUS_MSK;
+	ext->bkops_levels[ext->bkops_status]++;
+
+	if( ext->bkops_status == BKOPS_STATUS_OPERATIONS_NONE ||
+			( !tick && ext->bkops_status < BKOPS_STATUS_OPERATIONS_IMPACTED ) ) {
+		return( EOK );						// left to the idle scheduler
+	}
+
+		// with HPI, operations started while idle are left running and
+		// interrupted by the next request unless they are critical
+	nowait = tick && ( ext->eflags & SDMMC_EFLAG_HPI ) &&
+				ext->bkops_status < BKOPS_STATUS_OPERATIONS_CRITICAL;
 
-		if( ext->bkops_status ) {
-			ext->bkops_ticks++;
+	if( nowait ) {
+		status = sdio_mmc_switch_nowait( ext->device, MMC_SWITCH_CMDSET_DFLT, MMC_SWITCH_MODE_WRITE, ECSD_BKOPS_START, ECSD_BKOPS_INITIATE );
+	}
+	else {
+		status = sdio_mmc_switch( ext->device, MMC_SWITCH_CMDSET_DFLT, MMC_SWITCH_MODE_WRITE, ECSD_BKOPS_START, ECSD_BKOPS_INITIATE, SDIO_TIME_DEFAULT );
+	}
+
+	if( status == EOK ) {
+		ext->bkops_status	= BKOPS_STATUS_OPERATIONS_NONE;
+		ext->bkops_start	= nsec;
+		ext->bkops_starts++;
+		if( nowait ) {
+			ext->eflags |= SDMMC_EFLAG_BKOPS_BUSY;
+		}
+		else {
+			ext->bkops_time_ns += sdmmc_nsec( ) - nsec;
 		}
+	}
+	else {
+		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: BKOPS_START failure", __FUNCTION__ );
+	}
 
-		if( sdio_send_ext_csd( ext->device, ecsd ) == EOK ) {
-			if( ext->bkops_status != ecsd[ECSD_BKOPS_STATUS] ) {
-				ext->bkops_ticks	= 0;
-				ext->bkops_status	= ecsd[ECSD_BKOPS_STATUS];
-			}
+	return( EOK );
+}
+
+int sdmmc_packed_cfg( SIM_HBA *hba )
+{
+	SIM_SDMMC_EXT	*ext;
+	sdio_dev_info_t	*di;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	di		= &ext->dev_inf;
+
+	if( !( di->caps & DEV_CAP_PACKED ) || !( di->caps & DEV_CAP_CMD23 ) ||
+			!( ext->hc_inf.caps & HC_CAP_DMA ) || di->sector_size > SDMMC_PACKED_HDR_BSIZE ) {
+		return( ENOTSUP );
+	}
+
+	if( ext->pk_hdr == NULL ) {
+		if( ( ext->pk_hdr = xpt_alloc( XPT_ALLOC_CONTIG | XPT_ALLOC_NOCACHE, SDMMC_PACKED_HDR_BSIZE, NULL ) ) == MAP_FAILED ) {
+			cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: xpt_alloc packed header failure", __FUNCTION__ );
+			ext->pk_hdr = NULL;
+			return( ENOMEM );
 		}
+		ext->pk_hdr_paddr = xpt_vtop( ext->pk_hdr, NULL );
 	}
 
-	switch( ext->bkops_status ) {
-		case BKOPS_STATUS_OPERATIONS_NONE:
-			break;
-		
-		case BKOPS_STATUS_OPERATIONS_NON_CRITICAL:
-			if( ext->bkops_ticks < BKOPS_NC_TICKS ) {
-				break;
-			}
+		// header entry 0 is the header description
+	ext->pk_max = min( di->max_packed_writes, MMC_PACKED_HDR_SIZE / 8 - 1 );
+	ext->pk_max = min( ext->pk_max, SDMMC_PACKED_MAX );
 
-			// fall through
+	return( EOK );
+}
 
-		case BKOPS_STATUS_OPERATIONS_IMPACTED:
-			if( ext->bkops_ticks < BKOPS_IMPACTED_TICKS ) {
-				break;
-			}
+int sdmmc_ra_cfg( SIM_HBA *hba )
+{
+	SIM_SDMMC_EXT	*ext;
 
-			// fall through
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
 
-		case BKOPS_STATUS_OPERATIONS_CRITICAL:
-			if( sdio_mmc_switch( ext->device, MMC_SWITCH_CMDSET_DFLT, MMC_SWITCH_MODE_WRITE, ECSD_BKOPS_START, ECSD_BKOPS_INITIATE, SDIO_TIME_DEFAULT ) == EOK ) {
-				ext->bkops_status	= BKOPS_STATUS_OPERATIONS_NONE;
-				ext->bkops_ticks	= 0;
-			}
-			else {
-				cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: BKOPS_START failure", __FUNCTION__ );
-			}
-			break;
+	if( !( ext->hc_inf.caps & HC_CAP_DMA ) || ext->ra_max < ext->dev_inf.sector_size ) {
+		return( ENOTSUP );
 	}
-	
+
+	ext->ra_max = min( ext->ra_max, SDMMC_RA_MAX ) & ~( ext->dev_inf.sector_size - 1 );
+
+		// sized to the window, ra_max is not changed while the buffer exists
+	if( ( ext->ra_buf = xpt_alloc( XPT_ALLOC_CONTIG | XPT_ALLOC_NOCACHE, ext->ra_max, NULL ) ) == MAP_FAILED ) {
+		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: xpt_alloc read-ahead buffer failure", __FUNCTION__ );
+		ext->ra_buf = NULL;
+		return( ENOMEM );
+	}
+	ext->ra_paddr	= xpt_vtop( ext->ra_buf, NULL );
+	ext->ra_nlba	= 0;
+
 	return( EOK );
 }
 
@@ -1284,33 +1645,24 @@ int sdmmc_write_protect( SIM_HBA *hba, int op, int partition, int mode, uint32_t
 	return( status );
 }
 
-int sdmmc_rw( SIM_HBA *hba, SDMMC_PARTITION *part, int flgs, uint32_t addr, int dlen, sdio_sge_t *sgl, int sgc, void *mhdl, uint32_t timeout )
+static int sdmmc_rw_setup( SIM_HBA *hba, struct sdio_cmd *cmd, int flgs, uint32_t addr, int dlen, sdio_sge_t *sgl, int sgc, void *mhdl )
 {
 	SIM_SDMMC_EXT		*ext;
-	struct sdio_cmd		*cmd;
 	sdio_dev_info_t		*di;
-	struct sdio_device	*dev;
 	int					op;
 	int					blks;
 	int					blksz;
-	int					status;
-	int			bus_err;
-	uint32_t			cstatus;
-	uint32_t			rsp[4];
 
 	ext		= (SIM_SDMMC_EXT *)hba->ext;
-	dev		= ext->device;
 	di		= &ext->dev_inf;
 
-	bus_err		= CAM_FALSE;
-	timeout		*= 1000;
 	blksz		= di->sector_size;
 	blks		= dlen / blksz;
 	addr		= ( di->caps & DEV_CAP_HC ) ? addr : ( addr * blksz );
 	op		= ( flgs & SCF_DIR_IN ) ? MMC_READ_SINGLE_BLOCK : MMC_WRITE_BLOCK;
 
 	if( dlen > blksz ) {
-		if( !( ext->hc_inf.caps & HC_CAP_ACMD12 ) ) {
+		if( !( ext->hc_inf.caps & HC_CAP_ACMD12 ) || ( flgs & SCF_PACKED ) ) {
 			if( ( di->caps & DEV_CAP_CMD23 ) ) {
 				flgs |= SCF_SBC;
 			}
@@ -1322,12 +1674,44 @@ int sdmmc_rw( SIM_HBA *hba, SDMMC_PARTITION *part, int flgs, uint32_t addr, int
 		op++;
 	}
 
-	if( ( cmd = sdio_alloc_cmd( ) ) == NULL ) {
+	sdio_setup_cmd( cmd, SCF_CTYPE_ADTC | SCF_RSP_R1, op, addr );
+	sdio_setup_cmd_io( cmd, flgs, blks, blksz, sgl, sgc, mhdl );
+
+	return( flgs );
+}
+
+int sdmmc_rw( SIM_HBA *hba, SDMMC_PARTITION *part, int flgs, uint32_t addr, int dlen, sdio_sge_t *sgl, int sgc, void *mhdl, uint32_t timeout )
+{
+	SIM_SDMMC_EXT		*ext;
+	struct sdio_cmd		*cmd;
+	sdio_dev_info_t		*di;
+	struct sdio_device	*dev;
+	int					blks;
+	int					blksz;
+	int					status;
+	int			bus_err;
+	uint32_t			cstatus;
+	uint32_t			rsp[4];
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	dev		= ext->device;
+	di		= &ext->dev_inf;
+
+	bus_err		= CAM_FALSE;
+	timeout		*= 1000;
+	blksz		= di->sector_size;
+	blks		= dlen / blksz;
+
+		// a command staged by the pipeline was built from this same ccb,
+		// so the sgl the hc prepared is unchanged by the setup below
+	if( ( cmd = ext->ncmd ) != NULL ) {
+		ext->ncmd = NULL;
+	}
+	else if( ( cmd = sdio_alloc_cmd( ) ) == NULL ) {
 		return( ENOMEM );
 	}
 
-	sdio_setup_cmd( cmd, SCF_CTYPE_ADTC | SCF_RSP_R1, op, addr );
-	sdio_setup_cmd_io( cmd, flgs, blks, blksz, sgl, sgc, mhdl );
+	flgs = sdmmc_rw_setup( hba, cmd, flgs, addr, dlen, sgl, sgc, mhdl );
 	status = sdio_send_cmd( dev, cmd, NULL, timeout, 0 );
 	sdio_cmd_status( cmd, &cstatus, rsp );
 	sdio_free_cmd( cmd );
@@ -1396,8 +1780,8 @@ int sdmmc_rw( SIM_HBA *hba, SDMMC_PARTITION *part, int flgs, uint32_t addr, int
 	}
 
 	if( rsp[0] ) {
-		if( ( rsp[0] & CDS_URGENT_BKOPS ) ) {
-			ext->bkops_status = ECSD_BS_OPERATIONS_CRITICAL;
+		if( ( rsp[0] & CDS_URGENT_BKOPS ) ) {	// exception event
+			ext->eflags |= SDMMC_EFLAG_BKOPS_EE;
 		}
 		if( ( rsp[0] & CDS_ERROR ) ) {
 			status = EIO;
@@ -1501,31 +1885,309 @@ int sdmmc_write_verify( SIM_HBA *hba, CCB_SCSIIO *ccb )
 				}
 			}
 
-			if( memcmp( wptr, rptr, sgp->sg_count ) ) {
-				verification = CAM_FAILURE;
-				cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s:  write verification failed wrote", __FUNCTION__ );
-				cam_dump( wptr, sgp->sg_count );
-				cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s:  write verification failed read", __FUNCTION__ );
-				cam_dump( rptr, sgp->sg_count );
-			}
+			if( memcmp( wptr, rptr, sgp->sg_count ) ) {
+				verification = CAM_FAILURE;
+				cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s:  write verification failed wrote", __FUNCTION__ );
+				cam_dump( wptr, sgp->sg_count );
+				cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s:  write verification failed read", __FUNCTION__ );
+				cam_dump( rptr, sgp->sg_count );
+			}
+
+			if( ( ccb->cam_ch.cam_flags & CAM_DATA_PHYS ) ) {
+				munmap( wptr, sgp->sg_count );
+			}
+
+			rptr += sgp->sg_count;
+			wptr += sgp->sg_count;
+		}
+	}
+
+	if( verification != CAM_SUCCESS ) {
+		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s:  write verification failed", __FUNCTION__ );
+		status = sdmmc_error( hba, ccb, EIO );
+	}
+
+	return( status ? status : CAM_REQ_CMP );
+}
+#endif
+
+static sdio_sge_t *sdmmc_ccb_sgl( CCB_SCSIIO *ccb, sdio_sge_t *sge, int *sgc )
+{
+	if( ( ccb->cam_ch.cam_flags & CAM_SCATTER_VALID ) ) {
+		*sgc			= ccb->cam_sglist_cnt;
+		return( (sdio_sge_t *)ccb->cam_data.cam_sg_ptr );
+	}
+
+	*sgc			= 1;
+	sge->sg_count	= ccb->cam_dxfer_len;
+	sge->sg_address	= ccb->cam_data.cam_data_ptr;
+
+	return( sge );
+}
+
+static uint32_t sdmmc_ccb_lba( SDMMC_PARTITION *part, CCB_SCSIIO *ccb )
+{
+	uint32_t		lba;
+
+	lba		= ENDIAN_BE32( UNALIGNED_RET32( &ccb->cam_cdb_io.cam_cdb_bytes[2] ) );
+
+	if( part->blk_shft ) {
+		lba <<= part->blk_shft;
+	}
+
+	return( lba + part->slba );
+}
+
+static int sdmmc_packable( CCB_SCSIIO *ccb, CCB_SCSIIO *nccb )
+{
+	if( nccb->cam_ch.cam_func_code != XPT_SCSI_IO ||
+			nccb->cam_cdb_io.cam_cdb_bytes[0] != SC_WRITE10 ||
+			( nccb->cam_cdb_io.cam_cdb_bytes[1] & RW_OPT_FUA ) ||
+			!( nccb->cam_ch.cam_flags & CAM_DATA_PHYS ) ||
+			!nccb->cam_dxfer_len || nccb->cam_dxfer_len > SDMMC_PACKED_WR_MAX ||
+			nccb->cam_ch.cam_target_id != ccb->cam_ch.cam_target_id ||
+			nccb->cam_ch.cam_target_lun != ccb->cam_ch.cam_target_lun ) {
+		return( CAM_FALSE );
+	}
+
+	return( CAM_TRUE );
+}
+
+// Issue ccb and the small writes queued behind it to the same partition as
+// one packed write.  The data is preceded by a header block holding the
+// CMD23/CMD25 arguments of each write.  Returns EOK when all the packed
+// ccbs are complete, otherwise ccb is left for a normal write.
+static int sdmmc_packed_write( SIM_HBA *hba, SDMMC_PARTITION *part, CCB_SCSIIO *ccb, sdio_sge_t *sgp, int sgc )
+{
+	SIM_SDMMC_EXT	*ext;
+	sdio_dev_info_t	*di;
+	CCB_SCSIIO		*pccbs[SDMMC_PACKED_MAX];
+	CCB_SCSIIO		*nccb;
+	sdio_sge_t		sge;
+	uint32_t		*hdr;
+	uint32_t		lba;
+	int				sgmax;
+	int				nccbs;
+	int				nsgc;
+	int				dlen;
+	int				idx;
+	int				status;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	di		= &ext->dev_inf;
+	hdr		= ext->pk_hdr;
+	sgmax	= min( ext->hc_inf.sg_max, SDMMC_PACKED_SGE_MAX );
+
+	if( !sdmmc_packable( ccb, ccb ) || sgc + 1 > sgmax ) {
+		return( ENOTSUP );
+	}
+
+	memset( hdr, 0, MMC_PACKED_HDR_SIZE );
+	ext->pk_sgl[0].sg_address	= ext->pk_hdr_paddr;
+	ext->pk_sgl[0].sg_count		= di->sector_size;
+	nsgc						= 1;
+	dlen						= di->sector_size;
+
+	for( nccbs = 0, nccb = ccb; nccb; ) {
+		lba = sdmmc_ccb_lba( part, nccb );
+		if( nccbs ) {
+			sdmmc_ra_inval( hba, part->config, lba, nccb->cam_dxfer_len / di->sector_size );
+			if( ext->ndq ) {
+				sdmmc_discard_clip( hba, part->config, lba, nccb->cam_dxfer_len / di->sector_size );
+			}
+		}
+		hdr[( nccbs + 1 ) * 2]		= ENDIAN_LE32( nccb->cam_dxfer_len / di->sector_size );
+		hdr[( nccbs + 1 ) * 2 + 1]	= ENDIAN_LE32( ( di->caps & DEV_CAP_HC ) ? lba : ( lba * di->sector_size ) );
+		memcpy( &ext->pk_sgl[nsgc], sgp, sgc * sizeof( sdio_sge_t ) );
+		nsgc				+= sgc;
+		dlen				+= nccb->cam_dxfer_len;
+		pccbs[nccbs++]		= nccb;
+
+		if( nccbs >= ext->pk_max || ( nccb = simq_ccb_dequeue( hba->simq ) ) == NULL ) {
+			break;
+		}
+
+		sgp = sdmmc_ccb_sgl( nccb, &sge, &sgc );
+		if( !sdmmc_packable( ccb, nccb ) || nsgc + sgc > sgmax ||
+				( dlen + nccb->cam_dxfer_len ) / di->sector_size > MMC_SBC_BLKS_MSK ) {
+			simq_ccb_requeue( hba->simq, nccb );
+			break;
+		}
+	}
+
+	if( nccbs == 1 ) {
+		return( ENOTSUP );
+	}
+
+	hdr[0] = ENDIAN_LE32( ( nccbs << 16 ) | ( MMC_PACKED_RW_WRITE << 8 ) | MMC_PACKED_VERSION );
+
+	if( ( status = sdmmc_rw( hba, part, SCF_DIR_OUT | SCF_DATA_PHYS | SCF_PACKED, sdmmc_ccb_lba( part, ccb ),
+			dlen, ext->pk_sgl, nsgc, ccb->cam_req_map, ccb->cam_timeout ) ) != EOK ) {
+		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s: packed write failure %d, disabling packed writes", __FUNCTION__, status );
+		ext->eflags &= ~SDMMC_EFLAG_PACKED;
+		while( --nccbs ) {					// back in order, ccb is retried by the caller
+			simq_ccb_requeue( hba->simq, pccbs[nccbs] );
+		}
+		return( status );
+	}
+
+	part->wc--;				// header block
+
+	for( idx = 1; idx < nccbs; idx++ ) {
+		pccbs[idx]->cam_ch.cam_status = CAM_REQ_CMP;
+		simq_post_ccb( hba->simq, pccbs[idx] );
+	}
+
+	return( EOK );
+}
+
+// Map len bytes of a CAM_DATA_PHYS buffer.  The buffers come from the
+// io-blk cache, so the aligned windows around them are kept mapped and
+// reused rather than mapped and unmapped on every read-ahead hit.  Returns
+// NULL for a buffer that crosses a window boundary.
+static uint8_t *sdmmc_ra_map( SIM_SDMMC_EXT *ext, paddr_t paddr, uint32_t len )
+{
+	SDMMC_RA_MAP	*map;
+	paddr_t			base;
+	void			*vaddr;
+	int				idx;
+
+	base = paddr & ~( (paddr_t)SDMMC_RA_MAP_SIZE - 1 );
+	if( paddr + len > base + SDMMC_RA_MAP_SIZE ) {
+		return( NULL );
+	}
+
+	for( idx = 0; idx < SDMMC_RA_MAPS; idx++ ) {
+		map = &ext->ra_map[idx];
+		if( map->vaddr && map->paddr == base ) {
+			return( map->vaddr + ( paddr - base ) );
+		}
+	}
+
+	if( ( vaddr = mmap( NULL, SDMMC_RA_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_PHYS, NOFD, base ) ) == MAP_FAILED ) {
+		return( NULL );
+	}
+
+	map					= &ext->ra_map[ext->ra_map_next];
+	ext->ra_map_next	= ( ext->ra_map_next + 1 ) % SDMMC_RA_MAPS;
+	if( map->vaddr ) {
+		munmap( map->vaddr, SDMMC_RA_MAP_SIZE );
+	}
+	map->paddr	= base;
+	map->vaddr	= vaddr;
+
+	return( map->vaddr + ( paddr - base ) );
+}
+
+// Copy cached blocks starting at lba to the ccb buffers.
+static int sdmmc_ra_copy( SIM_HBA *hba, CCB_SCSIIO *ccb, uint32_t lba )
+{
+	SIM_SDMMC_EXT	*ext;
+	sdio_sge_t		*sgp;
+	sdio_sge_t		sge;
+	uint8_t			*src;
+	void			*dst;
+	uint32_t		len;
+	uint32_t		resid;
+	int				sgc;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	src		= ext->ra_buf + ( lba - ext->ra_lba ) * ext->dev_inf.sector_size;
+	resid	= ccb->cam_dxfer_len;
+	sgp		= sdmmc_ccb_sgl( ccb, &sge, &sgc );
+
+	for( ; sgc && resid; sgc--, sgp++ ) {
+		len = min( sgp->sg_count, resid );
+		if( ( ccb->cam_ch.cam_flags & CAM_DATA_PHYS ) ) {
+			if( ( dst = sdmmc_ra_map( ext, sgp->sg_address, len ) ) != NULL ) {
+				memcpy( dst, src, len );
+			}
+			else {
+				if( ( dst = mmap( NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_PHYS, NOFD, sgp->sg_address ) ) == MAP_FAILED ) {
+					return( errno );
+				}
+				memcpy( dst, src, len );
+				munmap( dst, len );
+			}
+		}
+		else {
+			memcpy( (void *)sgp->sg_address, src, len );
+		}
+		src		+= len;
+		resid	-= len;
+	}
+
+	return( EOK );
+}
+
+// Serve a read from the read-ahead cache.  On the second and following
+// reads of a sequential stream a miss reads a window ahead into the cache,
+// the window doubling on each refill up to ra_max.  Returns ENOTSUP when
+// the read is left to the normal path.
+static int sdmmc_ra_read( SIM_HBA *hba, SDMMC_PARTITION *part, CCB_SCSIIO *ccb )
+{
+	SIM_SDMMC_EXT	*ext;
+	sdio_sge_t		sge;
+	uint32_t		lba;
+	uint32_t		nlba;
+	uint32_t		win;
+	uint32_t		pend;
+	int				seq;
+	int				status;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	lba		= sdmmc_ccb_lba( part, ccb );
+	nlba	= ccb->cam_dxfer_len / ext->dev_inf.sector_size;
+	seq		= ( lba == part->ra_next );
+	part->ra_next = lba + nlba;
+
+	if( ext->ra_nlba && ext->ra_config == part->config &&
+			lba >= ext->ra_lba && lba + nlba <= ext->ra_lba + ext->ra_nlba ) {
+		ext->ra_hits++;
+		return( sdmmc_ra_copy( hba, ccb, lba ) );
+	}
+
+	ext->ra_misses++;
+
+	if( !seq ) {
+		part->ra_win = 0;
+		return( ENOTSUP );
+	}
+
+	win				= max( part->ra_win * 2, nlba * 2 );
+	win				= min( win, ext->ra_max / ext->dev_inf.sector_size );
+	part->ra_win	= win;
+	pend			= part->slba + part->nlba;
 
-			if( ( ccb->cam_ch.cam_flags & CAM_DATA_PHYS ) ) {
-				munmap( wptr, sgp->sg_count );
-			}
+	if( lba + win > pend ) {
+		win = pend - lba;
+	}
 
-			rptr += sgp->sg_count;
-			wptr += sgp->sg_count;
-		}
+	if( win <= nlba ) {
+		return( ENOTSUP );
 	}
 
-	if( verification != CAM_SUCCESS ) {
-		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s:  write verification failed", __FUNCTION__ );
-		status = sdmmc_error( hba, ccb, EIO );
+		// the staged command targets the ccb buffers, not the cache
+	if( ext->ncmd ) {
+		sdmmc_pipeline_flush( hba, CAM_FALSE );
 	}
 
-	return( status ? status : CAM_REQ_CMP );
+	ext->ra_nlba	= 0;
+	sge.sg_address	= ext->ra_paddr;
+	sge.sg_count	= win * ext->dev_inf.sector_size;
+
+	if( ( status = sdmmc_rw( hba, part, SCF_DIR_IN | SCF_DATA_PHYS, lba, sge.sg_count, &sge, 1, NULL, ccb->cam_timeout ) ) != EOK ) {
+		return( status );
+	}
+
+	ext->ra_config	= part->config;
+	ext->ra_lba		= lba;
+	ext->ra_nlba	= win;
+	ext->ra_fills++;
+	ext->ra_fill_blks += win;
+
+	return( sdmmc_ra_copy( hba, ccb, lba ) );
 }
-#endif
 
 int sdmmc_read_write( SIM_HBA *hba, CCB_SCSIIO *ccb, int flgs )
 {
@@ -1556,36 +2218,50 @@ int sdmmc_read_write( SIM_HBA *hba, CCB_SCSIIO *ccb, int flgs )
 		return( CAM_PROVIDE_FAIL );
 	}
 
+	if( ( flgs & SCF_DIR_OUT ) ) {
+		sdmmc_ra_inval( hba, part->config, sdmmc_ccb_lba( part, ccb ), ccb->cam_dxfer_len / ext->dev_inf.sector_size );
+
+			// a queued discard must not be issued over newer data
+		if( ext->ndq ) {
+			sdmmc_discard_clip( hba, part->config, sdmmc_ccb_lba( part, ccb ), ccb->cam_dxfer_len / ext->dev_inf.sector_size );
+		}
+	}
+
 	if( sdio_set_partition( ext->device, part->config ) != EOK ) {
 		return( CAM_PROVIDE_FAIL );
 	}
 
-	sdmmc_bkops( hba, CAM_FALSE );	// Check for urgent background operations
+	sdmmc_bkops( hba, CAM_FALSE );	// Handle urgent background operations
 
-	if( ( ccb->cam_ch.cam_flags & CAM_SCATTER_VALID ) ) {
-		sgc				= ccb->cam_sglist_cnt;
-		sgp				= (sdio_sge_t *)ccb->cam_data.cam_sg_ptr;
+	if( ( flgs & SCF_DIR_IN ) && ext->ra_buf ) {
+		if( ( status = sdmmc_ra_read( hba, part, ccb ) ) != ENOTSUP ) {
+			return( status ? sdmmc_error( hba, ccb, status ) : CAM_REQ_CMP );
+		}
 	}
-	else {
-		sgc				= 1;
-		sgp				= &sge;
-		sgp->sg_count	= ccb->cam_dxfer_len;
-		sgp->sg_address	= ccb->cam_data.cam_data_ptr;
+
+		// reuse the sge of a staged command so the prepared sgl stays valid
+	sgp		= sdmmc_ccb_sgl( ccb, ext->ncmd ? ext->nsge : &sge, &sgc );
+
+	if( ( flgs & SCF_DIR_OUT ) && ( ext->eflags & SDMMC_EFLAG_PACKED ) && !ext->ncmd && !ext->pccb ) {
+		if( sdmmc_packed_write( hba, part, ccb, sgp, sgc ) == EOK ) {
+			return( CAM_REQ_CMP );
+		}
 	}
 
 	if( ( ccb->cam_ch.cam_flags & CAM_DATA_PHYS ) ) {
 		flgs |= SCF_DATA_PHYS;
 	}
 
-	lba		= ENDIAN_BE32( UNALIGNED_RET32( &ccb->cam_cdb_io.cam_cdb_bytes[2] ) );
-
-	if( part->blk_shft ) {
-		lba <<= part->blk_shft;
-	}	
+	lba		= sdmmc_ccb_lba( part, ccb );
 
-	lba		+= part->slba;
+	if( ( status = sdmmc_rw( hba, part, flgs, lba, ccb->cam_dxfer_len, sgp, sgc, ccb->cam_req_map, ccb->cam_timeout ) ) == EOK ) {
+			// force unit access, write through the volatile cache
+		if( ( flgs & SCF_DIR_OUT ) && ( ccb->cam_cdb_io.cam_cdb_bytes[1] & RW_OPT_FUA ) ) {
+			status = sdio_flush_cache( ext->device );
+		}
+	}
 
-	if( ( status = sdmmc_rw( hba, part, flgs, lba, ccb->cam_dxfer_len, sgp, sgc, ccb->cam_req_map, ccb->cam_timeout ) ) != EOK ) {
+	if( status != EOK ) {
 		status = sdmmc_error( hba, ccb, status );
 	}
 
@@ -1690,6 +2366,8 @@ int sdmmc_erase_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb )
 		status = EINVAL;			// verify request is within partition
 	}
 	else {
+		sdmmc_ra_inval( hba, part->config, slba, nlba );
+
 		switch( erase->action ) {
 			case SDMMC_ERASE_ACTION_NORMAL:
 					// verify for erase group alignment
@@ -1789,6 +2467,8 @@ int sdmmc_lock_unlock_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb )
 		sdio_dev_info( ext->device, &ext->dev_inf );	// update device info
 	}
 
+	ext->ra_nlba = 0;				// lock state or contents changed
+
 	ccb->cam_devctl_status = status;
 
 	return( CAM_REQ_CMP );
@@ -1927,7 +2607,14 @@ int sdmmc_dsm( SIM_HBA *hba, SDMMC_PARTITION *part, DATA_SET_MGNT *dsm, int dtyp
 			break;
 		}
 
-		if( ( status = sdio_erase( ext->device, part->config, dtype, lba, nlba ) ) ) {
+		sdmmc_ra_inval( hba, part->config, lba, nlba );
+
+		if( ( ext->eflags & SDMMC_EFLAG_DISCARD ) ) {
+			if( ( status = sdmmc_discard_queue( hba, part->config, dtype, lba, nlba ) ) ) {
+				break;
+			}
+		}
+		else if( ( status = sdio_erase( ext->device, part->config, dtype, lba, nlba ) ) ) {
 			break;
 		}
 	}
@@ -2081,6 +2768,139 @@ int sdmmc_pwr_mgnt_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb )
 	return( CAM_REQ_CMP );
 }
 
+int sdmmc_bkops_stats_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb )
+{
+	SIM_SDMMC_EXT			*ext;
+	SDMMC_BKOPS_STATS		*bs;
+	int						status;
+	int						level;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	bs		= (SDMMC_BKOPS_STATS *)ccb->cam_devctl_data;
+	status	= EOK;
+
+	if( ccb->cam_devctl_size < ( sizeof( SDMMC_BKOPS_STATS ) ) ) {
+		status = EINVAL;
+	}
+	else if( !( ext->eflags & SDMMC_EFLAG_BKOPS ) ) {
+		status = ENOTSUP;
+	}
+	else {
+		switch( bs->action ) {
+			case SDMMC_BS_ACTION_GET:
+			case SDMMC_BS_ACTION_CLR:
+				bs->time		= ext->bkops_time_ns / 1000000;
+				bs->starts		= ext->bkops_starts;
+				bs->preempts	= ext->bkops_preempts;
+				bs->idle_time	= ext->bkops_idle_ns / 1000000;
+				for( level = SDMMC_BS_LEVEL_NONE; level <= SDMMC_BS_LEVEL_CRITICAL; level++ ) {
+					bs->levels[level] = ext->bkops_levels[level];
+				}
+
+				if( bs->action == SDMMC_BS_ACTION_CLR ) {
+					ext->bkops_time_ns = ext->bkops_starts = ext->bkops_preempts = 0;
+					memset( ext->bkops_levels, 0, sizeof( ext->bkops_levels ) );
+				}
+				break;
+
+			default:
+				status = EINVAL;
+				break;
+		}
+	}
+
+	ccb->cam_devctl_status = status;
+
+	return( CAM_REQ_CMP );
+}
+
+int sdmmc_ra_stats_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb )
+{
+	SIM_SDMMC_EXT			*ext;
+	SDMMC_RA_STATS			*ra;
+	int						status;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	ra		= (SDMMC_RA_STATS *)ccb->cam_devctl_data;
+	status	= EOK;
+
+	if( ccb->cam_devctl_size < ( sizeof( SDMMC_RA_STATS ) ) ) {
+		status = EINVAL;
+	}
+	else if( ext->ra_buf == NULL ) {
+		status = ENOTSUP;
+	}
+	else {
+		switch( ra->action ) {
+			case SDMMC_RA_ACTION_GET:
+			case SDMMC_RA_ACTION_CLR:
+				ra->window		= ext->ra_max;
+				ra->hits		= ext->ra_hits;
+				ra->misses		= ext->ra_misses;
+				ra->fills		= ext->ra_fills;
+				ra->fill_blks	= ext->ra_fill_blks;
+				ra->invals		= ext->ra_invals;
+
+				if( ra->action == SDMMC_RA_ACTION_CLR ) {
+					ext->ra_hits = ext->ra_misses = ext->ra_fills = 0;
+					ext->ra_fill_blks = ext->ra_invals = 0;
+				}
+				break;
+
+			default:
+				status = EINVAL;
+				break;
+		}
+	}
+
+	ccb->cam_devctl_status = status;
+
+	return( CAM_REQ_CMP );
+}
+
+int sdmmc_pipeline_stats_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb )
+{
+	SIM_SDMMC_EXT			*ext;
+	SDMMC_PIPELINE_STATS	*pl;
+	sdio_hc_info_t			hc_inf;
+	int						status;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+	pl		= (SDMMC_PIPELINE_STATS *)ccb->cam_devctl_data;
+	status	= EOK;
+
+	if( ccb->cam_devctl_size < ( sizeof( SDMMC_PIPELINE_STATS ) ) ) {
+		status = EINVAL;
+	}
+	else {
+		switch( pl->action ) {
+			case SDMMC_PL_ACTION_GET:
+			case SDMMC_PL_ACTION_CLR:
+				sdio_hc_info( ext->device, &hc_inf );
+				pl->xfers		= hc_inf.xfers - ext->pl_base[0];
+				pl->prepared	= hc_inf.xfer_preps - ext->pl_base[1];
+				pl->gaps		= hc_inf.xfer_gaps - ext->pl_base[2];
+				pl->gap_time	= hc_inf.xfer_gap_ns - ext->pl_base[3];
+
+				if( pl->action == SDMMC_PL_ACTION_CLR ) {
+					ext->pl_base[0] = hc_inf.xfers;
+					ext->pl_base[1] = hc_inf.xfer_preps;
+					ext->pl_base[2] = hc_inf.xfer_gaps;
+					ext->pl_base[3] = hc_inf.xfer_gap_ns;
+				}
+				break;
+
+			default:
+				status = EINVAL;
+				break;
+		}
+	}
+
+	ccb->cam_devctl_status = status;
+
+	return( CAM_REQ_CMP );
+}
+
 int sdmmc_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb )
 {
 	struct _client_info     *info_p;
@@ -2142,6 +2962,18 @@ int sdmmc_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb )
 			status = sdmmc_pwr_mgnt_devctl( hba, ccb );
 			break;
 
+		case DCMD_SDMMC_BKOPS_STATS:
+			status = sdmmc_bkops_stats_devctl( hba, ccb );
+			break;
+
+		case DCMD_SDMMC_RA_STATS:
+			status = sdmmc_ra_stats_devctl( hba, ccb );
+			break;
+
+		case DCMD_SDMMC_PIPELINE_STATS:
+			status = sdmmc_pipeline_stats_devctl( hba, ccb );
+			break;
+
 		case DCMD_CAM_VERBOSITY:
 			status = sdmmc_verbosity_devctl( hba, ccb );
 			break;
@@ -2248,6 +3080,121 @@ int sdmmc_scsi_io( SIM_HBA *hba, CCB_SCSIIO *ccb )
 	return( status );
 }
 
+static int sdmmc_rw_ccb( SIM_HBA *hba, CCB_SCSIIO *ccb )
+{
+	SIM_SDMMC_EXT	*ext;
+	SDMMC_PARTITION	*part;
+	int				cmd;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+
+	if( ccb->cam_ch.cam_func_code != XPT_SCSI_IO || !ccb->cam_dxfer_len ) {
+		return( CAM_FALSE );
+	}
+
+	cmd		= ccb->cam_cdb_io.cam_cdb_bytes[0];
+	part	= &ext->targets[ccb->cam_ch.cam_target_id].partitions[ccb->cam_ch.cam_target_lun];
+
+	if( ( cmd != SC_READ10 && cmd != SC_WRITE10 ) ||
+			( part->config & MMC_PART_MSK ) == MMC_PART_RPMB ) {
+		return( CAM_FALSE );
+	}
+
+	if( ( ccb->cam_ch.cam_flags & CAM_DATA_PHYS ) && !( ext->hc_inf.caps & HC_CAP_DMA ) ) {
+		return( CAM_FALSE );
+	}
+
+	return( CAM_TRUE );
+}
+
+// Take the ccb queued behind a read/write and stage its command so the
+// host controller can prepare the DMA while the current one is on the bus.
+// The ccb is still executed strictly after the current one.
+static void sdmmc_pipeline( SIM_HBA *hba, CCB_SCSIIO *ccb )
+{
+	SIM_SDMMC_EXT	*ext;
+	CCB_SCSIIO		*nccb;
+	SDMMC_PARTITION	*part;
+	struct sdio_cmd	*cmd;
+	sdio_sge_t		*sgp;
+	int				sgc;
+	int				flgs;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+
+	if( ext->pccb || !sdmmc_rw_ccb( hba, ccb ) ) {
+		return;
+	}
+
+		// leave the queue to sdmmc_packed_write()
+	if( ( ext->eflags & SDMMC_EFLAG_PACKED ) && sdmmc_packable( ccb, ccb ) ) {
+		return;
+	}
+
+	if( ( nccb = simq_ccb_dequeue( hba->simq ) ) == NULL ) {
+		return;
+	}
+
+		// only a read/write is held back, anything else (resets, aborts,
+		// devctls) stays on the simq where the reset/abort handling sees it
+	if( !sdmmc_rw_ccb( hba, nccb ) || ( cmd = sdio_alloc_cmd( ) ) == NULL ) {
+		simq_ccb_requeue( hba->simq, nccb );
+		return;
+	}
+
+	ext->pccb	= nccb;
+
+	part		= &ext->targets[nccb->cam_ch.cam_target_id].partitions[nccb->cam_ch.cam_target_lun];
+	flgs		= ( nccb->cam_cdb_io.cam_cdb_bytes[0] == SC_READ10 ) ? SCF_DIR_IN : SCF_DIR_OUT;
+
+	if( ( nccb->cam_ch.cam_flags & CAM_DATA_PHYS ) ) {
+		flgs |= SCF_DATA_PHYS;
+	}
+
+	ext->psgi	^= 1;
+	sgp			= sdmmc_ccb_sgl( nccb, &ext->psge[ext->psgi], &sgc );
+
+	sdmmc_rw_setup( hba, cmd, flgs, sdmmc_ccb_lba( part, nccb ),
+			nccb->cam_dxfer_len, sgp, sgc, nccb->cam_req_map );
+
+	ext->pcmd	= cmd;
+	sdio_prep_cmd( ext->device, cmd );
+}
+
+// Drop the nexus' staged command when the nexus completed without it (a
+// read-ahead hit, a packed write, an error) and, optionally, put the
+// lookahead ccb back at the head of the queue.  Otherwise the lookahead
+// command is staged again so the next data transfer still prepares it.
+int sdmmc_pipeline_flush( SIM_HBA *hba, int requeue )
+{
+	SIM_SDMMC_EXT	*ext;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+
+	if( ext->ncmd || ( requeue && ext->pcmd ) ) {
+		sdio_prep_cmd( ext->device, NULL );
+	}
+
+	if( ext->ncmd ) {
+		sdio_free_cmd( ext->ncmd );
+		ext->ncmd = NULL;
+	}
+
+	if( requeue && ext->pccb ) {
+		if( ext->pcmd ) {
+			sdio_free_cmd( ext->pcmd );
+			ext->pcmd = NULL;
+		}
+		simq_ccb_requeue( hba->simq, ext->pccb );
+		ext->pccb = NULL;
+	}
+	else if( ext->pcmd ) {
+		sdio_prep_cmd( ext->device, ext->pcmd );
+	}
+
+	return( EOK );
+}
+
 void sdmmc_start_ccb( SIM_HBA *hba )
 {
 	SIM_SDMMC_EXT	*ext;
@@ -2258,7 +3205,17 @@ void sdmmc_start_ccb( SIM_HBA *hba )
 	ext = (SIM_SDMMC_EXT *)hba->ext;
 
 	do {
-		if( ( ext->nexus = ccb = simq_ccb_dequeue( hba->simq ) ) == NULL ) {
+		if( ( ccb = ext->pccb ) != NULL ) {		// lookahead taken by the pipeline
+			ext->pccb	= NULL;
+			ext->ncmd	= ext->pcmd;
+			ext->nsge	= &ext->psge[ext->psgi];
+			ext->pcmd	= NULL;
+		}
+		else {
+			ccb = simq_ccb_dequeue( hba->simq );
+		}
+
+		if( ( ext->nexus = ccb ) == NULL ) {
 #ifdef SDMMC_AGGRESSIVE_PM
 				// In aggressive pm mode we direct call the sdio layer,
 				// so we don't have the overhead of enabling/disabling
@@ -2273,6 +3230,14 @@ void sdmmc_start_ccb( SIM_HBA *hba )
 		clock_gettime( CLOCK_MONOTONIC, &ts );
 		ext->pm_timestamp = timespec2nsec( &ts );
 
+		if( ( ext->eflags & SDMMC_EFLAG_BKOPS_BUSY ) ) {
+			sdmmc_bkops_hpi( hba );
+		}
+
+		if( ( ext->eflags & SDMMC_EFLAG_PIPELINE ) ) {
+			sdmmc_pipeline( hba, ccb );
+		}
+
 		switch( ccb->cam_ch.cam_func_code ) {
 			case XPT_SCSI_IO:
 				status = sdmmc_scsi_io( hba, (CCB_SCSIIO *)ccb );
@@ -2289,6 +3254,11 @@ void sdmmc_start_ccb( SIM_HBA *hba )
 				break;
 		}
 
+			// on error the lookahead goes back so retries keep their order
+		if( ext->ncmd || ( ext->pccb && status != CAM_REQ_CMP ) ) {
+			sdmmc_pipeline_flush( hba, status != CAM_REQ_CMP );
+		}
+
 		if( status != CAM_REQ_INPROG ) {
 			ccb->cam_ch.cam_status = status;
 			sdmmc_post_ccb( hba, ccb );
@@ -2310,7 +3280,7 @@ int sdmmc_timer( SIM_HBA *hba )
 
 	status = EOK;
 	pm_state = ext->pm_state;
-	if( ext->nexus || pm_state == PM_SLEEP ) {
+	if( ext->nexus || pm_state == PM_SLEEP || ( ext->eflags & SDMMC_EFLAG_BKOPS_BUSY ) ) {
 		return( status );
 	}
 
@@ -2332,6 +3302,22 @@ int sdmmc_timer( SIM_HBA *hba )
 	return( status );
 }
 
+// Issue the queued discards once the device has been idle for a while.
+static void sdmmc_discard_idle( SIM_HBA *hba )
+{
+	SIM_SDMMC_EXT	*ext;
+
+	ext		= (SIM_SDMMC_EXT *)hba->ext;
+
+	if( !ext->ndq || ext->nexus || ( ext->eflags & SDMMC_EFLAG_BKOPS_BUSY ) ||
+			sdmmc_nsec( ) < ext->pm_timestamp + SDMMC_TIMEOUT_MS_TO_NS( SDMMC_DISCARD_IDLE ) ) {
+		return;
+	}
+
+	sdmmc_pm( hba, PM_ACTIVE );
+	sdmmc_discard_flush( hba );
+}
+
 void *sdmmc_driver_thread( void *hdl )
 {
 	SIM_HBA			*hba;
@@ -2363,7 +3349,7 @@ void *sdmmc_driver_thread( void *hdl )
 
 		// initialize SIM queue routines
 	if( !stat && ( hba->simq = simq_init( hba->coid, hba, MAX_NARROW_TARGET,
-			MAX_LUN, 2, 1, 2, ( ext->eflags & SDMMC_EFLAG_BKOPS ) ? 1 : 0 ) ) == NULL ) {
+			MAX_LUN, 2, 1, 2, ( ext->eflags & ( SDMMC_EFLAG_BKOPS | SDMMC_EFLAG_DISCARD ) ) ? 1 : 0 ) ) == NULL ) {
 		cam_slogf( _SLOGC_SIM_MMC, _SLOG_ERROR, 1, 1, "%s:  simq_init failure", __FUNCTION__ );
 		stat = CAM_TRUE;
 	}
@@ -2386,7 +3372,8 @@ void *sdmmc_driver_thread( void *hdl )
 				break;
 
 			case SIM_TIMER:
-				if( ext->pm_state == PM_ACTIVE ) {
+				if( ext->pm_state != PM_SLEEP ) {
+					sdmmc_discard_idle( hba );
 					sdmmc_bkops( hba, CAM_TRUE );
 				}
 				break;
@@ -2443,6 +3430,8 @@ int sdmmc_sim_detach( )
 // asserted.
 int sdmmc_reset_bus( SIM_HBA *hba, CCB_RESETBUS *ccb )
 {
+		// the lookahead ccb goes back on the simq so the reset completes it
+	sdmmc_pipeline_flush( hba, CAM_TRUE );
 	simq_scsi_reset( hba->simq );
 	xpt_async( AC_BUS_RESET, hba->pathid, -1, -1, NULL, 0 );
 	return( CAM_REQ_CMP );
@@ -2455,6 +3444,7 @@ int sdmmc_reset_bus( SIM_HBA *hba, CCB_RESETBUS *ccb )
 // always result in a bus device reset message being issued over SCSI.
 int sdmmc_reset_dev( SIM_HBA *hba, CCB_RESETDEV *ccb )
 {
+	sdmmc_pipeline_flush( hba, CAM_TRUE );
 	simq_reset_dev( hba->simq, ccb );
 	xpt_async( AC_SENT_BDR, hba->pathid, -1, -1, NULL, 0 );
 	return( CAM_REQ_CMP );
@@ -2692,6 +3682,13 @@ int sdmmc_sim_args( char *options )
 							"partitions",
 							"bs",
 							"pwroff_notify",
+							"pipeline",
+							"cache",
+							"hpi",
+							"packed",
+							"bkops_idle",
+							"discard",
+							"readahead",
 							NULL
 						};
 
@@ -2778,6 +3775,55 @@ int sdmmc_sim_args( char *options )
 
 				break;
 
+			case 7:							// pipeline
+				SDMMC_ARG_VAL( opts[opt], value );
+				if( !strcmp( value, "on" ) ) {
+					ext->eflags |= SDMMC_EFLAG_PIPELINE;
+				}
+				break;
+
+			case 8:							// cache
+				SDMMC_ARG_VAL( opts[opt], value );
+				if( !strcmp( value, "on" ) ) {
+					ext->eflags |= SDMMC_EFLAG_CACHE;
+				}
+				break;
+
+			case 9:							// hpi
+				SDMMC_ARG_VAL( opts[opt], value );
+				if( !strcmp( value, "on" ) ) {
+					ext->eflags |= SDMMC_EFLAG_HPI;
+				}
+				break;
+
+			case 10:						// packed
+				SDMMC_ARG_VAL( opts[opt], value );
+				if( !strcmp( value, "on" ) ) {
+					ext->eflags |= SDMMC_EFLAG_PACKED;
+				}
+				break;
+
+			case 11:						// bkops_idle
+				SDMMC_ARG_VAL( opts[opt], value );
+				if( ( val = cam_parse_number( value ) ) != CAM_INVALID_NUM ) {
+					ext->bkops_idle_ns = SDMMC_TIMEOUT_MS_TO_NS( val );
+				}
+				break;
+
+			case 12:						// discard
+				SDMMC_ARG_VAL( opts[opt], value );
+				if( !strcmp( value, "on" ) ) {
+					ext->eflags |= SDMMC_EFLAG_DISCARD;
+				}
+				break;
+
+			case 13:						// readahead
+				SDMMC_ARG_VAL( opts[opt], value );
+				if( ( val = cam_parse_number( value ) ) != CAM_INVALID_NUM ) {
+					ext->ra_max = val * 1024;
+				}
+				break;
+
 			default:
 				break;
 		}
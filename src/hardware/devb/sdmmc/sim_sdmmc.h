@@ -78,6 +78,8 @@
 #define SDMMC_TIME_INFINITY				0xffffffff
 
 #define SDMMC_PM_TIMER					0x40		// Timer event
+#define SDMMC_BKOPS_IDLE				2000		// ms idle before BKOPS
+#define SDMMC_DISCARD_IDLE				500			// ms idle before queued discards
 
 #define SDMMC_MAX_BUS					10
 
@@ -130,8 +132,22 @@ typedef struct _sdmmc_partition {
 	_Uint64t		tc;				// TRIM Count
 	_Uint64t		ec;				// Erase Count
 	_Uint64t		dc;				// Discard Count
+	_Uint32t		ra_next;		// lba following the last read
+	_Uint32t		ra_win;			// current read-ahead window (blocks)
 } SDMMC_PARTITION;
 
+typedef struct _sdmmc_discard {
+	_Uint32t		config;			// hw partition
+	_Uint32t		dtype;			// MMC_ERASE_TRIM/DISCARD
+	_Uint32t		lba;
+	_Uint32t		nlba;
+} SDMMC_DISCARD;
+
+typedef struct _sdmmc_ra_map {
+	paddr_t			paddr;			// SDMMC_RA_MAP_SIZE aligned
+	_Uint8t			*vaddr;			// NULL when unused
+} SDMMC_RA_MAP;
+
 typedef struct _sdmmc_target {
 	_Uint32t			nluns;
 	_Uint32t			blksz;
@@ -150,6 +166,13 @@ typedef struct _sim_sdmmc_ext {
 #define SDMMC_EFLAG_ASSD_SEND_STOP		(1 << 6)
 #define SDMMC_EFLAG_DEV_BUSY			(1 << 7)
 #define SDMMC_EFLAG_PWROFF_NOTIFY		(1 << 8)
+#define SDMMC_EFLAG_PIPELINE			(1 << 9)	// stage next r/w during transfer
+#define SDMMC_EFLAG_CACHE				(1 << 10)	// eMMC volatile cache
+#define SDMMC_EFLAG_HPI					(1 << 11)	// eMMC high priority interrupt
+#define SDMMC_EFLAG_PACKED				(1 << 12)	// eMMC packed writes
+#define SDMMC_EFLAG_BKOPS_BUSY			(1 << 13)	// BKOPS running, stop with HPI
+#define SDMMC_EFLAG_BKOPS_EE			(1 << 14)	// urgent BKOPS exception in R1
+#define SDMMC_EFLAG_DISCARD				(1 << 15)	// queue and coalesce TRIM/DISCARD
 #define SDMMC_EFLAG_BS					(1 << 24)
 	_Uint32t				eflags;
 	_Uint8t					priority;
@@ -158,6 +181,46 @@ typedef struct _sim_sdmmc_ext {
 
 	CCB_SCSIIO				*nexus;
 
+	CCB_SCSIIO				*pccb;			// lookahead ccb (pipeline)
+	struct sdio_cmd			*pcmd;			// command staged for pccb
+	struct sdio_cmd			*ncmd;			// command staged for nexus
+	int						psgi;
+	sdio_sge_t				psge[2];		// sge's of staged non scatter ccbs
+	sdio_sge_t				*nsge;			// psge slot owned by ncmd
+	_Uint64t				pl_base[4];		// hc transfer stats at last clear
+
+#define SDMMC_PACKED_MAX		32				// ccbs per packed write
+#define SDMMC_PACKED_SGE_MAX	64
+#define SDMMC_PACKED_WR_MAX		( 32 * 1024 )	// largest write packed
+#define SDMMC_PACKED_HDR_BSIZE	4096			// largest sector size
+	_Uint32t				pk_max;			// entries per packed write
+	_Uint32t				*pk_hdr;		// packed command header block
+	paddr_t					pk_hdr_paddr;
+	sdio_sge_t				pk_sgl[SDMMC_PACKED_SGE_MAX];
+
+#define SDMMC_DISCARD_MAX		64				// queued discard ranges
+#define SDMMC_DISCARD_NLBA		( 256 * 1024 )	// queued sectors before issue
+	_Uint32t				ndq;
+	_Uint32t				dq_nlba;		// sectors queued
+	SDMMC_DISCARD			dq[SDMMC_DISCARD_MAX];
+
+#define SDMMC_RA_MAX			( 256 * 1024 )	// largest read-ahead window
+	_Uint32t				ra_max;			// read-ahead window (bytes)
+	_Uint8t					*ra_buf;		// read-ahead cache
+	paddr_t					ra_paddr;
+	_Uint32t				ra_config;		// hw partition of cached blocks
+	_Uint32t				ra_lba;
+	_Uint32t				ra_nlba;		// cached blocks, 0 when empty
+	_Uint64t				ra_hits;
+	_Uint64t				ra_misses;
+	_Uint64t				ra_fills;
+	_Uint64t				ra_fill_blks;
+	_Uint64t				ra_invals;
+#define SDMMC_RA_MAPS			8				// windows kept mapped for CAM_DATA_PHYS ccbs
+#define SDMMC_RA_MAP_SIZE		( 1024 * 1024 )
+	SDMMC_RA_MAP			ra_map[SDMMC_RA_MAPS];
+	_Uint32t				ra_map_next;	// next window to replace
+
 	struct sdio_device		*device;
 	sdio_device_instance_t	instance;
 	sdio_hc_info_t			hc_inf;
@@ -174,14 +237,19 @@ typedef struct _sim_sdmmc_ext {
 #define SDMMC_PM_ACTIVE							2
 	_Uint32t				pm_state;
 
-#define BKOPS_NC_TICKS							10
-#define BKOPS_IMPACTED_TICKS					5
-	_Uint32t				bkops_ticks;
+	_Uint64t				bkops_idle_ns;	// idle time before starting BKOPS
+	_Uint64t				bkops_idle_chk;	// pm_timestamp of idle period checked
+	_Uint64t				bkops_start;
+	_Uint64t				bkops_time_ns;	// time spent in BKOPS
+	_Uint64t				bkops_starts;
+	_Uint64t				bkops_preempts;	// BKOPS interrupted by HPI
 #define BKOPS_STATUS_OPERATIONS_NONE			0
 #define BKOPS_STATUS_OPERATIONS_NON_CRITICAL	1
 #define BKOPS_STATUS_OPERATIONS_IMPACTED		2
 #define BKOPS_STATUS_OPERATIONS_CRITICAL		3
+#define BKOPS_STATUS_MSK						3
 	_Uint32t				bkops_status;
+	_Uint64t				bkops_levels[BKOPS_STATUS_MSK + 1];	// BKOPS_STATUS seen
 
 	SDMMC_ASSD_PROPERTIES	assd_properties;
 	int						assd_active_sec_sys;
@@ -207,11 +275,17 @@ extern void *sdmmc_driver_thread( void *data );
 extern void sdmmc_display_ccb( SIM_HBA *hba, CCB *ccb );
 
 extern int sdmmc_bkops_cfg( SIM_HBA *hba );
+extern int sdmmc_bkops_hpi( SIM_HBA *hba );
+extern int sdmmc_discard_flush( SIM_HBA *hba );
+extern int sdmmc_hpi_cfg( SIM_HBA *hba );
+extern int sdmmc_packed_cfg( SIM_HBA *hba );
+extern int sdmmc_ra_cfg( SIM_HBA *hba );
 extern int sdmmc_pwroff_notify( SIM_HBA *hba, uint8_t cfg );
 extern int sdmmc_unit_ready( SIM_HBA *hba, CCB_SCSIIO *ccb );
 extern int sdmmc_wp_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb );
 extern int sdmmc_erase_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb );
 extern int sdmmc_card_register_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb );
+extern int sdmmc_pipeline_flush( SIM_HBA *hba, int requeue );
 extern int sdmmc_rw( SIM_HBA *hba, SDMMC_PARTITION *part, int flgs, uint32_t addr, int dlen, sdio_sge_t *sgl, int sgc, void *mhdl, uint32_t timeout );
 extern int sim_bs_partition_config( SIM_HBA *hba );
 extern int sim_bs_devctl( SIM_HBA *hba, CCB_DEVCTL *ccb );
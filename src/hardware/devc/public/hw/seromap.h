@@ -23,6 +23,7 @@
 #ifndef SEROMAP_H_
 #define SEROMAP_H_
 
+#include <stdint.h>
 #include <devctl.h>
 
 #define _DCMD_SEROMAP  _DCMD_MISC
@@ -34,6 +35,28 @@
  */
 #define DCMD_SEROMAP_BT_EN				__DIOT(_DCMD_SEROMAP, 1, int)
 
+/**
+ * Receive interrupt statistics. The interrupt rate and the bytes per
+ * interrupt follow from the counters and the elapsed time.
+ * flags - SEROMAP_RX_STATS_CLR to reset the counters after reading them
+ */
+typedef struct _seromap_rx_stats {
+	uint32_t	flags;
+	uint32_t	rx_trig;		/* Current RX FIFO trigger level */
+	uint64_t	nsec;			/* Time since the counters were reset */
+	uint64_t	rx_intr;		/* RX, RX timeout and line status interrupts */
+	uint64_t	rx_timeout;		/* RX timeout interrupts */
+	uint64_t	rx_bytes;		/* Bytes received */
+	uint64_t	tx_intr;		/* TX FIFO threshold interrupts */
+	uint32_t	trig_changes;	/* Adaptive RX trigger level changes */
+	uint32_t	adaptive;		/* RX trigger level is adaptive */
+	uint32_t	reserved[4];
+} seromap_rx_stats_t;
+
+#define SEROMAP_RX_STATS_CLR			0x01
+
+#define DCMD_SEROMAP_RX_STATS			__DIOTF(_DCMD_SEROMAP, 2, seromap_rx_stats_t)
+
 #endif /* SEROMAP_H_ */
 
 #if defined(__QNXNTO__) && defined(__USESRCVERSION)
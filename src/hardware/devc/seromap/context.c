@@ -81,8 +81,11 @@ int omap_uart_ctx_restore(DEV_OMAP *dev)
 	// set MCR bit 6 to enable access to TCR and TLR registers
 	set_port(port[OMAP_UART_MCR], OMAP_MCR_TCRTLR, OMAP_MCR_TCRTLR);
 
-	// clear FIFO
-	write_omap(port[OMAP_UART_FCR], OMAP_FCR_ENABLE | OMAP_FCR_RXCLR | OMAP_FCR_TXCLR);
+	// clear FIFO, keeping the adaptive RX trigger level the driver is tracking
+	if (dev->rx_adaptive)
+		write_omap(port[OMAP_UART_FCR], OMAP_FCR_ENABLE | OMAP_FCR_RXCLR | OMAP_FCR_TXCLR | OMAP_FCR_RXTRIG(dev->rx_level));
+	else
+		write_omap(port[OMAP_UART_FCR], OMAP_FCR_ENABLE | OMAP_FCR_RXCLR | OMAP_FCR_TXCLR);
 
 	// switch to Configuration Mode B
 	CONFIG_MODE_B(port);
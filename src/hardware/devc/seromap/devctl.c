@@ -0,0 +1,94 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2008, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#include "externs.h"
+#include <time.h>
+
+static uint64_t
+stats_now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (timespec2nsec(&ts));
+}
+
+static int
+rx_stats(DEV_OMAP *dev, seromap_rx_stats_t *st)
+{
+	uint32_t	flags = st->flags;
+
+	/* The counters are updated by the ISR */
+	InterruptLock(&dev->rx_spinlock);
+	*st = dev->stats;
+	if (flags & SEROMAP_RX_STATS_CLR)
+		memset(&dev->stats, 0, sizeof(dev->stats));
+	InterruptUnlock(&dev->rx_spinlock);
+
+	st->flags = flags;
+	st->rx_trig = dev->rx_trig;
+	st->adaptive = dev->rx_adaptive;
+	st->nsec = stats_now() - dev->stats_start;
+	if (flags & SEROMAP_RX_STATS_CLR)
+		dev->stats_start += st->nsec;
+
+	return (EOK);
+}
+
+/*
+ * Driver specific devctls, anything else is left to io-char.
+ */
+int
+seromap_devctl(resmgr_context_t *ctp, io_devctl_t *msg, iofunc_ocb_t *ocb)
+{
+	DEV_OMAP	*dev = (DEV_OMAP *)ocb->attr;
+	void		*data = _DEVCTL_DATA(msg->i);
+	int			status;
+
+	switch (msg->i.dcmd) {
+		case DCMD_SEROMAP_RX_STATS:
+			if (msg->i.nbytes < sizeof(seromap_rx_stats_t))
+				return (EINVAL);
+			if ((status = rx_stats(dev, data)) != EOK)
+				return (status);
+			memset(&msg->o, 0, sizeof(msg->o));
+			msg->o.nbytes = sizeof(seromap_rx_stats_t);
+			return (_RESMGR_PTR(ctp, &msg->o, sizeof(msg->o) + sizeof(seromap_rx_stats_t)));
+	}
+
+#ifdef PWR_MAN
+	return (extra_devctl(ctp, msg, ocb));
+#else
+	return (_RESMGR_DEFAULT);
+#endif
+}
+
+void
+seromap_stats_init(DEV_OMAP *dev)
+{
+	memset(&dev->stats, 0, sizeof(dev->stats));
+	dev->stats_start = stats_now();
+}
+
+#if defined(__QNXNTO__) && defined(__USESRCVERSION)
+#include <sys/srcversion.h>
+__SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/devc/seromap/devctl.c $ $Rev: 765543 $")
+#endif
@@ -0,0 +1,467 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2008, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#include "externs.h"
+#include <sys/mman.h>
+#include <sys/rsrcdbmgr.h>
+#include <arm/dm6446.h>
+
+#define OPT_TCINTEN		(1 << 20)
+#define OPT_TCC(x)		((x) << 12)
+#define OPT_SYNCDIM		(1 << 2)
+
+static inline void
+edma_setbit(uintptr_t base, int reg, int bit)
+{
+	if (bit > 31)
+		reg += 4, bit -= 32;
+
+	out32(base + reg, (1 << bit));
+}
+
+static edma_t *
+edma_param(DEV_OMAP *dev, int set)
+{
+	return ((edma_t *)(dev->edma_vbase + DM6446_EDMA_PARAM_BASE + (0x20 * set)));
+}
+
+/*
+ * Offset in the RX ring that the EDMA will write next. The channel's
+ * PaRAM set is updated after every trigger-sized transfer, and reloaded
+ * from the ping or pong set when a half completes.
+ */
+unsigned
+seromap_edma_rx_pos(DEV_OMAP *dev)
+{
+	return (edma_param(dev, dev->edma_rx_chid)->dst - dev->rx_pbuf);
+}
+
+/*
+ * Stop the RX channel and find how far the ring holds received bytes. The
+ * PaRAM destination moves when a transfer is submitted to the transfer
+ * controller, not when its bytes reach memory, so the position only
+ * counts once the TC has gone idle after it was read. *end is set to the
+ * ring offset up to which the bytes are in memory. Returns -1 if the TC
+ * stayed busy: *end then stops short of the last burst, which may still
+ * be in flight.
+ */
+int
+seromap_edma_rx_drain(DEV_OMAP *dev, unsigned *end)
+{
+	unsigned	pos, ring = 2 * dev->rx_half, spin = SEROMAP_EDMA_DRAIN;
+
+	seromap_edma_rx_stop(dev);
+
+	/* an event latched before the stop may still be submitted */
+	do {
+		pos = seromap_edma_rx_pos(dev);
+		while ((in32(dev->edma_tc_vbase + SEROMAP_EDMA_TCSTAT) & SEROMAP_EDMA_TCSTAT_ACTV) && --spin)
+			;
+	} while (spin && seromap_edma_rx_pos(dev) != pos);
+
+	*end = pos;
+	if (spin)
+		return (0);
+
+	/* bursts are rx_trig aligned in the ring */
+	if ((pos + ring - dev->rx_tail) % ring >= dev->rx_trig)
+		*end = (pos + ring - dev->rx_trig) % ring;
+	else
+		*end = dev->rx_tail;
+
+	return (-1);
+}
+
+/*
+ * Pass the received bytes from rx_tail up to pos to io-char.
+ */
+int
+seromap_edma_rx(DEV_OMAP *dev, unsigned pos, int *cnt)
+{
+	unsigned	tail = dev->rx_tail;
+	int			n, status = 0;
+
+	while (tail != pos) {
+		n = (pos > tail ? pos : 2 * dev->rx_half) - tail;
+		status |= seromap_tti_bulk(dev, &dev->rx_buf[tail], n);
+		if ((tail += n) == 2 * dev->rx_half)
+			tail = 0;
+		*cnt += n;
+	}
+	dev->rx_tail = tail;
+
+	return (status);
+}
+
+void
+seromap_edma_rx_stop(DEV_OMAP *dev)
+{
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_EECR, dev->edma_rx_chid);
+}
+
+void
+seromap_edma_rx_start(DEV_OMAP *dev)
+{
+	uintptr_t	region0base = dev->edma_vbase + DM6446_EDMA_REGION0;
+
+	/*
+	 * Drop any request latched while the FIFO was drained by PIO, it
+	 * would make the EDMA read a full trigger level from a short FIFO.
+	 */
+	edma_setbit(region0base, DM6446_EDMA_ECR,  dev->edma_rx_chid);
+	edma_setbit(region0base, DM6446_EDMA_SECR, dev->edma_rx_chid);
+	edma_setbit(dev->edma_vbase, DM6446_EDMA_EMCR, dev->edma_rx_chid);
+	edma_setbit(region0base, DM6446_EDMA_EESR, dev->edma_rx_chid);
+}
+
+static struct sigevent *
+queue_event(DEV_OMAP *dev)
+{
+	if (dev->tty.flags & EVENT_QUEUED)
+		return (NULL);
+
+	dev_lock(&ttyctrl);
+	ttyctrl.event_queue[ttyctrl.num_events++] = &dev->tty;
+	atomic_set(&dev->tty.flags, EVENT_QUEUED);
+	dev_unlock(&ttyctrl);
+
+	return (&ttyctrl.event);
+}
+
+/*
+ * EDMA receive completion interrupt: one half of the RX ring has been filled.
+ */
+static const struct sigevent *
+seromap_edma_rxintr(void *area, int id)
+{
+	DEV_OMAP		*dev = area;
+	unsigned		done, end;
+	int				status = 0, cnt = 0;
+
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_ICR, dev->edma_rx_chid);
+
+	InterruptLock(&dev->rx_spinlock);
+
+	/*
+	 * Only consume the completed half, the transfer that the linked set
+	 * has just started may not have reached memory yet. The RX timeout
+	 * interrupt may already have consumed part or all of it.
+	 */
+	done = (seromap_edma_rx_pos(dev) < dev->rx_half) ? dev->rx_half : 0;
+	end = done ? 0 : dev->rx_half;
+	if (dev->rx_tail >= done && dev->rx_tail < done + dev->rx_half)
+		status = seromap_edma_rx(dev, end, &cnt);
+	dev->stats.rx_intr++;
+	dev->stats.rx_bytes += cnt;
+
+	InterruptUnlock(&dev->rx_spinlock);
+
+	return (status ? queue_event(dev) : NULL);
+}
+
+/*
+ * EDMA transmit completion interrupt: the bounce buffer has been written
+ * to the FIFO, let tto() refill it.
+ */
+static const struct sigevent *
+seromap_edma_txintr(void *area, int id)
+{
+	DEV_OMAP		*dev = area;
+	uintptr_t		region0base = dev->edma_vbase + DM6446_EDMA_REGION0;
+
+	edma_setbit(region0base, DM6446_EDMA_ICR,  dev->edma_tx_chid);
+	edma_setbit(region0base, DM6446_EDMA_EECR, dev->edma_tx_chid);
+
+	dev->tx_busy = 0;
+	dev->tty.un.s.tx_tmr = 0;
+	atomic_set(&dev->tty.flags, EVENT_TTO);
+
+	return (queue_event(dev));
+}
+
+/*
+ * Start draining obuf through EDMA. The characters are taken from obuf
+ * (with output processing) into the bounce buffer. The first ones, up to
+ * a TX trigger level, are written by PIO: this both keeps the EDMA part a
+ * whole number of trigger levels and produces the FIFO level change that
+ * raises the first TX request. Returns -1 if the FIFO has no room for that
+ * and tto() should wait for the TX interrupt instead.
+ */
+int
+seromap_edma_tx(DEV_OMAP *dev)
+{
+	TTYBUF			*bup = &dev->tty.obuf;
+	const uintptr_t	*port = dev->port;
+	uintptr_t		region0base = dev->edma_vbase + DM6446_EDMA_REGION0;
+	edma_t			*param;
+	unsigned		n, pio;
+
+	if (FIFO_SIZE - read_omap(port[OMAP_UART_TXFIFO_LVL]) < dev->tx_trig)
+		return (-1);
+
+	dev_lock(&dev->tty);
+	for (n = 0; n < SEROMAP_TXDMA_SIZE && bup->cnt > 0; n++)
+		dev->tx_buf[n] = tto_getchar(&dev->tty);
+	dev_unlock(&dev->tty);
+
+	if ((pio = n % dev->tx_trig) == 0)
+		pio = min(n, dev->tx_trig);
+
+	edma_setbit(region0base, DM6446_EDMA_EECR, dev->edma_tx_chid);
+	edma_setbit(region0base, DM6446_EDMA_ECR,  dev->edma_tx_chid);
+	edma_setbit(region0base, DM6446_EDMA_SECR, dev->edma_tx_chid);
+	edma_setbit(dev->edma_vbase, DM6446_EDMA_EMCR, dev->edma_tx_chid);
+
+	if (n > pio) {
+		param = edma_param(dev, dev->edma_tx_chid);
+		param->opt         = OPT_SYNCDIM | OPT_TCINTEN | OPT_TCC(dev->edma_tx_chid);
+		param->src         = dev->tx_pbuf + pio;
+		param->abcnt       = (dev->tx_trig << 16) | 1;
+		param->dst         = dev->physbase_rhr;
+		param->srcdstbidx  = (0 << 16) | 1;
+		param->linkbcntrld = 0xFFFF;
+		param->srcdstcidx  = (0 << 16) | dev->tx_trig;
+		param->ccnt        = (n - pio) / dev->tx_trig;
+		dev->tx_busy = 1;
+	}
+
+	/* A request raised by these writes is latched until the event is enabled */
+	dev->tty.un.s.tx_tmr = 3;
+	for (n = 0; n < pio; n++)
+		write_omap(port[OMAP_UART_THR], dev->tx_buf[n]);
+
+	if (dev->tx_busy)
+		edma_setbit(region0base, DM6446_EDMA_EESR, dev->edma_tx_chid);
+
+	return (0);
+}
+
+/*
+ * Output flow control while an EDMA transfer is in progress: stop or
+ * resume the requests, the PaRAM set keeps the position.
+ */
+void
+seromap_edma_tx_pause(DEV_OMAP *dev, int pause)
+{
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0,
+				pause ? DM6446_EDMA_EECR : DM6446_EDMA_EESR, dev->edma_tx_chid);
+}
+
+/*
+ * Program the ping and pong PaRAM sets. Each EDMA event moves one RX
+ * trigger level worth of bytes (AB-synchronized), each set covers half
+ * of the ring and links to the other one.
+ */
+static void
+seromap_edma_setup(DEV_OMAP *dev)
+{
+	edma_t		*param;
+	int			i, set[2];
+
+	set[0] = dev->edma_rx_chid + SEROMAP_EDMA_RELOAD;
+	set[1] = dev->edma_rx_chid + 2 * SEROMAP_EDMA_RELOAD;
+
+	for (i = 0; i < 2; i++) {
+		param = edma_param(dev, set[i]);
+		param->opt         = OPT_SYNCDIM | OPT_TCINTEN | OPT_TCC(dev->edma_rx_chid);
+		param->src         = dev->physbase_rhr;
+		param->abcnt       = (dev->rx_trig << 16) | 1;
+		param->dst         = dev->rx_pbuf + i * dev->rx_half;
+		param->srcdstbidx  = (1 << 16) | 0;
+		param->linkbcntrld = (dev->rx_trig << 16) | (DM6446_EDMA_PARAM_BASE + (0x20 * set[i ^ 1]));
+		param->srcdstcidx  = (dev->rx_trig << 16) | 0;
+		param->ccnt        = dev->rx_half / dev->rx_trig;
+	}
+
+	memcpy((void *)edma_param(dev, dev->edma_rx_chid), (void *)edma_param(dev, set[0]), sizeof(edma_t));
+	dev->rx_tail = 0;
+
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_ICR,  dev->edma_rx_chid);
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_IESR, dev->edma_rx_chid);
+}
+
+static int
+edma_channel_attach(int chid)
+{
+	rsrc_request_t	req = { 0 };
+
+	req.length = 1;
+	req.start = req.end = chid;
+	req.flags = RSRCDBMGR_DMA_CHANNEL | RSRCDBMGR_FLAG_RANGE;
+	if (rsrcdbmgr_attach(&req, 1) == -1) {
+		slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: Unable to acquire EDMA channel %d (%d)", chid, errno);
+		return (-1);
+	}
+
+	return (0);
+}
+
+static void
+edma_channel_detach(int chid)
+{
+	rsrc_request_t	req = { 0 };
+
+	req.length = 1;
+	req.start = req.end = chid;
+	req.flags = RSRCDBMGR_DMA_CHANNEL | RSRCDBMGR_FLAG_RANGE;
+	rsrcdbmgr_detach(&req, 1);
+}
+
+static int
+seromap_edma_rx_init(DEV_OMAP *dev)
+{
+	unsigned	queue;
+
+	/* Whole number of trigger levels per half */
+	if (dev->rx_trig == 0)
+		dev->rx_trig = 8;
+	dev->rx_half = (SEROMAP_RXDMA_HALF / dev->rx_trig) * dev->rx_trig;
+
+	if (edma_channel_attach(dev->edma_rx_chid) == -1)
+		return (-1);
+
+	/* The queue of the channel selects its transfer controller */
+	queue = (in32(dev->edma_vbase + DM6446_EDMA_DMAQNUM(dev->edma_rx_chid >> 3)) >> ((dev->edma_rx_chid & 7) * 4)) & 7;
+	dev->edma_tc_vbase = mmap_device_io(SEROMAP_EDMA_TC_SIZE, SEROMAP_EDMA_TC_BASE + queue * SEROMAP_EDMA_TC_STRIDE);
+	if (dev->edma_tc_vbase == (uintptr_t)MAP_FAILED) {
+		slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: Unable to map EDMA TC%d (%d)", queue, errno);
+		goto fail;
+	}
+
+	dev->rx_buf = mmap(0, 2 * dev->rx_half, PROT_READ | PROT_WRITE | PROT_NOCACHE,
+				MAP_ANON | MAP_PHYS | MAP_PRIVATE, NOFD, 0);
+	if (dev->rx_buf == MAP_FAILED) {
+		slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: Allocation of EDMA receive buffer failed (%d)", errno);
+		goto fail2;
+	}
+	dev->rx_pbuf = mphys(dev->rx_buf);
+
+	seromap_edma_rx_stop(dev);
+	seromap_edma_setup(dev);
+
+	dev->edma_rx_iid = InterruptAttach(dev->edma_rx_irq, seromap_edma_rxintr, dev, 0, _NTO_INTR_FLAGS_TRK_MSK);
+	if (dev->edma_rx_iid == -1) {
+		slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: Unable to attach EDMA irq 0x%x (%d)", dev->edma_rx_irq, errno);
+		goto fail1;
+	}
+
+	dev->edma_rx = 1;
+	return (0);
+
+fail1:
+	munmap(dev->rx_buf, 2 * dev->rx_half);
+fail2:
+	munmap_device_io(dev->edma_tc_vbase, SEROMAP_EDMA_TC_SIZE);
+fail:
+	edma_channel_detach(dev->edma_rx_chid);
+	return (-1);
+}
+
+static int
+seromap_edma_tx_init(DEV_OMAP *dev)
+{
+	/* seromap_edma_tx() sizes the PIO head from TXFIFO_LVL */
+	if (!dev->fifo_lvl) {
+		slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: EDMA transmit needs the TX FIFO level register (UART MVR 5.2 or later)");
+		return (-1);
+	}
+
+	if (dev->tx_trig == 0)
+		dev->tx_trig = 8;
+
+	if (edma_channel_attach(dev->edma_tx_chid) == -1)
+		return (-1);
+
+	dev->tx_buf = mmap(0, SEROMAP_TXDMA_SIZE, PROT_READ | PROT_WRITE | PROT_NOCACHE,
+				MAP_ANON | MAP_PHYS | MAP_PRIVATE, NOFD, 0);
+	if (dev->tx_buf == MAP_FAILED) {
+		slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: Allocation of EDMA transmit buffer failed (%d)", errno);
+		goto fail;
+	}
+	dev->tx_pbuf = mphys(dev->tx_buf);
+
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_EECR, dev->edma_tx_chid);
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_ICR,  dev->edma_tx_chid);
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_IESR, dev->edma_tx_chid);
+
+	dev->edma_tx_iid = InterruptAttach(dev->edma_tx_irq, seromap_edma_txintr, dev, 0, _NTO_INTR_FLAGS_TRK_MSK);
+	if (dev->edma_tx_iid == -1) {
+		slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: Unable to attach EDMA irq 0x%x (%d)", dev->edma_tx_irq, errno);
+		goto fail1;
+	}
+
+	dev->edma_tx = 1;
+	return (0);
+
+fail1:
+	munmap(dev->tx_buf, SEROMAP_TXDMA_SIZE);
+fail:
+	edma_channel_detach(dev->edma_tx_chid);
+	return (-1);
+}
+
+int
+seromap_edma_init(DEV_OMAP *dev, TTYINIT_OMAP *dip)
+{
+	unsigned	irq = dip->edma_irq ? dip->edma_irq : SEROMAP_EDMA_IRQ_BASE;
+	unsigned	mode;
+
+	dev->edma_pbase = SEROMAP_EDMA_BASE;
+	dev->physbase_rhr = dip->tty.port + OMAP_UART_RHR;
+	dev->edma_rx_chid = dip->edma_rx_chid;
+	dev->edma_rx_irq = irq + dip->edma_rx_chid;
+	dev->edma_tx_chid = dip->edma_tx_chid;
+	dev->edma_tx_irq = irq + dip->edma_tx_chid;
+
+	dev->edma_vbase = (uintptr_t)mmap_device_memory(0, DM6446_EDMA_SIZE,
+				PROT_READ | PROT_WRITE | PROT_NOCACHE, 0, dev->edma_pbase);
+	if (dev->edma_vbase == (uintptr_t)MAP_FAILED) {
+		slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: Unable to map EDMA (%d)", errno);
+		return (-1);
+	}
+
+	if (dev->edma_rx_chid != -1)
+		seromap_edma_rx_init(dev);
+	if (dev->edma_tx_chid != -1)
+		seromap_edma_tx_init(dev);
+
+	if (dev->edma_rx && dev->edma_tx)
+		mode = OMAP_SCR_DMAMODE_RXTX;
+	else if (dev->edma_rx)
+		mode = OMAP_SCR_DMAMODE_RX;
+	else if (dev->edma_tx)
+		mode = OMAP_SCR_DMAMODE_TX;
+	else {
+		munmap_device_memory((void *)dev->edma_vbase, DM6446_EDMA_SIZE);
+		return (-1);
+	}
+
+	/* Route the UART DMA requests to the EDMA */
+	set_port(dev->port[OMAP_UART_SCR], OMAP_SCR_DMAMODE_CTL | OMAP_SCR_DMAMODE_MSK,
+				OMAP_SCR_DMAMODE_CTL | mode);
+
+	return (0);
+}
+
+#if defined(__QNXNTO__) && defined(__USESRCVERSION)
+#include <sys/srcversion.h>
+__SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/devc/seromap/edma.c $ $Rev: 765543 $")
+#endif
@@ -48,6 +48,7 @@
 #include <sys/slogcodes.h>
 
 #include <sys/trace.h>
+#include <hw/seromap.h>
 
 char    *user_parm;
 
@@ -76,6 +77,15 @@ char    *user_parm;
 #define OMAP_UART_WER     0x5C
 #endif
 
+#ifndef OMAP5910
+/* Increase the UART size to include the FIFO level registers, which only
+ * exist from the OMAP3630 UART (MVR 5.2) on, see DEV_OMAP fifo_lvl */
+#undef OMAP_UART_SIZE
+#define OMAP_UART_SIZE          0x6C
+#define OMAP_UART_RXFIFO_LVL    0x64
+#define OMAP_UART_TXFIFO_LVL    0x68
+#endif
+
 #define FIFO_TRIG_8       1
 #define FIFO_TRIG_16      2
 #define FIFO_TRIG_32      3
@@ -84,6 +94,42 @@ char    *user_parm;
 
 #define FIFO_SIZE         64 /* size of the rx and tx fifo's */
 
+/* Adaptive RX trigger: levels selected through FCR[7:6] (TLR RX is 0) */
+#define OMAP_FCR_RXTRIG(l)      ((l) << 6)  /* 0: 8, 1: 16, 2: 56 */
+#define SEROMAP_RX_LEVELS       3
+#define SEROMAP_RX_ADAPT        4   /* Consecutive interrupts before a change */
+
+/* EDMA receive and transmit */
+#define SEROMAP_EDMA_BASE       0x49000000  /* EDMA0 channel controller */
+#define SEROMAP_EDMA_IRQ_BASE   0x200       /* Per-channel completion vectors */
+#define SEROMAP_EDMA_RELOAD     64          /* Offset of the ping/pong link PaRAM sets */
+#define SEROMAP_RXDMA_HALF      2048        /* Max size of each half of the RX ring */
+#define SEROMAP_TXDMA_SIZE      4096        /* Max size of one TX transfer */
+#define SEROMAP_TXDMA_MIN       256         /* Smaller obuf drains are done by PIO */
+#define SEROMAP_EDMA_TC_BASE    0x49800000  /* TPTC0, TC n is at + n * SEROMAP_EDMA_TC_STRIDE */
+#define SEROMAP_EDMA_TC_STRIDE  0x100000
+#define SEROMAP_EDMA_TC_SIZE    0x400
+#define SEROMAP_EDMA_TCSTAT     0x100
+#define SEROMAP_EDMA_TCSTAT_ACTV (1 << 8)   /* TC has a transfer in progress */
+#define SEROMAP_EDMA_DRAIN      1000        /* TCSTAT polls before giving up */
+
+#define OMAP_SCR_DMAMODE_CTL    (1 << 0)
+#define OMAP_SCR_DMAMODE_MSK    (3 << 1)
+#define OMAP_SCR_DMAMODE_RXTX   (1 << 1)    /* DMA mode 1: RX and TX requests */
+#define OMAP_SCR_DMAMODE_RX     (2 << 1)    /* DMA mode 2: RX requests only */
+#define OMAP_SCR_DMAMODE_TX     (3 << 1)    /* DMA mode 3: TX requests only */
+
+typedef struct {
+    volatile uint32_t   opt;
+    volatile uint32_t   src;
+    volatile uint32_t   abcnt;
+    volatile uint32_t   dst;
+    volatile uint32_t   srcdstbidx;
+    volatile uint32_t   linkbcntrld;
+    volatile uint32_t   srcdstcidx;
+    volatile uint32_t   ccnt;
+} edma_t;
+
 typedef struct dev_omap {
     TTYDEV          tty;
     struct dev_omap *next;
@@ -104,6 +150,41 @@ typedef struct dev_omap {
 #define    SEROMAP_PWM_PAGED    0x1    /* Flag to tell tto not to transmit data */
     unsigned        auto_rts_enable;
     unsigned        no_msr_int; /* Do not enable MSR interrupt */
+    unsigned        rx_trig;    /* RX fifo trigger level in bytes */
+    unsigned        tx_trig;    /* TX fifo trigger level in spaces */
+    unsigned        fifo_lvl;   /* RXFIFO_LVL and TXFIFO_LVL are implemented */
+    unsigned        rx_adaptive;
+    unsigned        rx_level;   /* OMAP_FCR_RXTRIG level */
+    int             rx_streak;  /* >0 threshold, <0 timeout interrupts in a row */
+    seromap_rx_stats_t stats;
+    uint64_t        stats_start;
+
+    uint32_t        edma_pbase;
+    uintptr_t       edma_vbase;
+    uint32_t        physbase_rhr;   /* RHR/THR as seen by the EDMA */
+
+    /* EDMA receive: the FIFO is drained into a ping/pong ring by EDMA,
+     * the ISR only runs on half completion, RX timeout and line errors */
+    unsigned        edma_rx;
+    int             edma_rx_chid;
+    int             edma_rx_irq;
+    int             edma_rx_iid;
+    unsigned char   *rx_buf;
+    uint32_t        rx_pbuf;
+    unsigned        rx_half;    /* size of each half of the ring */
+    unsigned        rx_tail;    /* next byte to pass to io-char */
+    uintptr_t       edma_tc_vbase;  /* transfer controller of the RX channel's queue */
+    intrspin_t      rx_spinlock;
+
+    /* EDMA transmit: large obuf drains are copied to a bounce buffer and
+     * written to THR by EDMA, one TX trigger level per request */
+    unsigned        edma_tx;
+    int             edma_tx_chid;
+    int             edma_tx_irq;
+    int             edma_tx_iid;
+    unsigned char   *tx_buf;
+    uint32_t        tx_pbuf;
+    volatile unsigned tx_busy;  /* EDMA transfer in progress */
 #ifdef PWR_MAN
     intrspin_t      idle_spinlock;
     uint32_t        physbase;
@@ -122,6 +203,10 @@ typedef struct ttyinit_omap {
     unsigned       loopback;    /*loopback mode*/
     unsigned       auto_rts_enable;
     unsigned       no_msr_int; /* Do not enable MSR interrupt */
+    int            edma_rx_chid; /* EDMA receive channel, -1 for PIO */
+    int            edma_tx_chid; /* EDMA transmit channel, -1 for PIO */
+    int            edma_irq;     /* EDMA channel 0 completion irq, 0 for default */
+    unsigned       rx_adaptive;  /* Adapt the RX trigger level to the load */
 }TTYINIT_OMAP;
 
 #define    SEROMAP_NUM_POWER_MODES    4
@@ -122,6 +122,9 @@ create_device(TTYINIT_OMAP *dip, unsigned unit, unsigned maxim_xcvr_kick)
 	uintptr_t			port;
 	unsigned char		msr;
 	unsigned char		tlr = 0, tcr = 0;
+#ifndef OMAP5910
+	uint32_t			mvr;
+#endif
 #ifdef PWR_MAN
 	clk_enable_t		clk_cfg = clk_enable_none;
 #endif
@@ -307,8 +310,22 @@ create_device(TTYINIT_OMAP *dip, unsigned unit, unsigned maxim_xcvr_kick)
 			}
 		}
 
+		/*
+		 * Adaptive RX trigger: leave the TLR RX level at 0 so that the level
+		 * can be changed at run time with a single FCR write. Not with EDMA
+		 * receive, its transfers are sized by the trigger level.
+		 */
+		if (dip->rx_adaptive && dip->edma_rx_chid == -1) {
+			dev->rx_adaptive = 1;
+			dev->rx_level = 1;
+			tlr &= 0x0f;
+			write_omap(dev->port[OMAP_UART_FCR], OMAP_FCR_ENABLE | OMAP_FCR_RXTRIG(dev->rx_level));
+		}
+
 		write_omap(dev->port[OMAP_UART_TCR], tcr);
 		write_omap(dev->port[OMAP_UART_TLR], tlr);
+		dev->rx_trig = dev->rx_adaptive ? 16 : (tlr >> 4) * 4;
+		dev->tx_trig = (tlr & 0x0f) * 4;
 #ifdef PWR_MAN
 		write_omap(dev->port[OMAP_UART_SCR], OMAP_SCR_WAKEUPEN);
 #else
@@ -323,8 +340,20 @@ create_device(TTYINIT_OMAP *dip, unsigned unit, unsigned maxim_xcvr_kick)
 		/* clr MCR bit 6 to remove access to TCR and TLR registers */
 		set_port(dev->port[OMAP_UART_MCR], OMAP_MCR_TCRTLR, 0);
 
+#ifndef OMAP5910
+		/* The FIFO level registers came with the OMAP3630 UART (legacy MVR
+		 * 5.2), UARTs with the new MVR scheme (bits 31:30 = 1) all have them */
+		mvr = in32(dev->port[OMAP_UART_MVR]);
+		dev->fifo_lvl = (mvr >> 30) ? 1 : ((mvr & 0xff) >= 0x52);
+#endif
+
+		if ((dip->edma_rx_chid != -1 || dip->edma_tx_chid != -1) && seromap_edma_init(dev, dip) == -1)
+			slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_ERROR, "io-char: EDMA unavailable, using PIO");
+
 		ser_stty(dev);
 		ser_attach_intr(dev);
+		if (dev->edma_rx)
+			seromap_edma_rx_start(dev);
 	}
 
 	/* Set modem control lines to a ready state */
@@ -348,11 +377,13 @@ create_device(TTYINIT_OMAP *dip, unsigned unit, unsigned maxim_xcvr_kick)
 	if ((msr & OMAP_MSR_DCTS) && (dev->tty.c_cflag & OHFLOW))
 		tti(&dev->tty, (msr & OMAP_MSR_CTS) ? TTI_OHW_CONT : TTI_OHW_STOP);
 
+	seromap_stats_init(dev);
+
 	// Attach the resource manager
 	ttc(TTC_INIT_ATTACH, &dev->tty, 0);
 
+	dev->tty.io_devctlext = seromap_devctl;
 #ifdef PWR_MAN
-	dev->tty.io_devctlext = extra_devctl;
 #ifdef WINBT
 	omap_force_rts(dev, 1);
 #endif
@@ -61,17 +61,115 @@ process_lsr(DEV_OMAP *dev, unsigned char lsr)
 	return(tti(&dev->tty, key) | eventflag);
 }
 
+/*
+ * Pass a run of error free characters to io-char. Each one goes through
+ * tti() for the input processing, flow control and reader notification,
+ * io-char has no interface to queue a run at once.
+ */
+int
+seromap_tti_bulk(DEV_OMAP *dev, const unsigned char *buf, int n)
+{
+	int		i, status = 0;
+
+	for (i = 0; i < n; i++)
+		status |= tti(&dev->tty, buf[i]);
+
+	return (status);
+}
+
+/*
+ * Drain the receive FIFO. Where RXFIFO_LVL exists and the FIFO holds no
+ * error, the characters are read in runs sized by the RX FIFO level, LSR
+ * is only checked per character when an error is flagged somewhere in the
+ * FIFO or the level is unknown.
+ */
+static int
+rx_fifo(DEV_OMAP *dev, int *cnt)
+{
+	uintptr_t		*port = dev->port;
+	unsigned char	lsr;
+	int				status = 0;
+#ifndef OMAP5910
+	unsigned char	buf[FIFO_SIZE];
+	int				n, lvl;
+#endif
+
+	lsr = read_omap(port[OMAP_UART_LSR]);
+	while (lsr & OMAP_LSR_RXRDY && *cnt < FIFO_SIZE) {
+#ifndef OMAP5910
+		if (dev->fifo_lvl &&
+			(lsr & (OMAP_LSR_RCV_FIFO | OMAP_LSR_BI | OMAP_LSR_OE | OMAP_LSR_FE | OMAP_LSR_PE)) == 0) {
+			lvl = read_omap(port[OMAP_UART_RXFIFO_LVL]);
+			lvl = max(1, min(lvl, FIFO_SIZE - *cnt));
+			for (n = 0; n < lvl; n++)
+				buf[n] = read_omap(port[OMAP_UART_RHR]);
+			status |= seromap_tti_bulk(dev, buf, n);
+			*cnt += n;
+			lsr = read_omap(port[OMAP_UART_LSR]);
+			continue;
+		}
+#endif
+		if (lsr & (OMAP_LSR_BI | OMAP_LSR_OE | OMAP_LSR_FE | OMAP_LSR_PE)) {
+			// Error character
+			status |= process_lsr(dev, lsr);
+		}
+		else {
+			// Good character
+			status |= tti(&dev->tty, (read_omap(port[OMAP_UART_RHR])) & 0xff);
+			(*cnt)++;
+		}
+		lsr = read_omap(port[OMAP_UART_LSR]);
+	}
+
+	return (status);
+}
+
+/*
+ * Adaptive RX trigger level. Interrupts at the trigger level in a row mean
+ * sustained traffic: raise the level to take fewer interrupts. RX timeouts
+ * in a row mean sparse traffic, the timeout already bounds the latency but
+ * a lower level leaves more FIFO headroom for the next burst.
+ */
+static void
+rx_adapt(DEV_OMAP *dev, unsigned iir)
+{
+	static const unsigned char	trig[SEROMAP_RX_LEVELS] = { 8, 16, 56 };
+	unsigned					level = dev->rx_level;
+
+	if (iir == OMAP_II_RX) {
+		if (dev->rx_streak < 0)
+			dev->rx_streak = 0;
+		if (++dev->rx_streak >= SEROMAP_RX_ADAPT && level < SEROMAP_RX_LEVELS - 1)
+			level++;
+	}
+	else if (iir == OMAP_II_RXTO) {
+		if (dev->rx_streak > 0)
+			dev->rx_streak = 0;
+		if (--dev->rx_streak <= -SEROMAP_RX_ADAPT && level > 0)
+			level--;
+	}
+
+	/* FCR is not reachable while ser_stty() has the UART in a configuration mode */
+	if (level != dev->rx_level && !(dev->lcr & OMAP_LCR_DLAB)) {
+		write_omap(dev->port[OMAP_UART_FCR], OMAP_FCR_ENABLE | OMAP_FCR_RXTRIG(level));
+		dev->rx_level = level;
+		dev->rx_trig = trig[level];
+		dev->rx_streak = 0;
+		dev->stats.trig_changes++;
+	}
+}
+
 /*
  * Serial interrupt handler
  */
 const struct sigevent *
 ser_intr(void *area, int id)
 {
-	int				status, cnt;
-	unsigned char	msr, lsr;
+	int				status, cnt, drained;
+	unsigned char	msr;
 	DEV_OMAP		*dev = area;
 	struct sigevent *event = NULL;
-	unsigned		iir;
+	unsigned		iir, end;
 	uintptr_t		*port = dev->port;
 
 #ifdef PWR_MAN
@@ -129,19 +227,35 @@ ser_intr(void *area, int id)
 			case OMAP_II_RXTO:		// Receive data timeout
 			case OMAP_II_LS:		// Line status change
 				cnt = 0;
-				lsr = read_omap(port[OMAP_UART_LSR]);
-				do {
-					if (lsr & (OMAP_LSR_BI | OMAP_LSR_OE | OMAP_LSR_FE | OMAP_LSR_PE)) {
-						// Error character
-						status |= process_lsr(dev, lsr);
-					}
-					else {
-						// Good character
-						status |= tti(&dev->tty, (read_omap(port[OMAP_UART_RHR])) & 0xff);
-						cnt++;
-					}
-					lsr = read_omap(port[OMAP_UART_LSR]);
-				} while(lsr & OMAP_LSR_RXRDY && cnt < FIFO_SIZE);
+				if (dev->edma_rx) {
+					/*
+					 * Hand over what the EDMA has written to memory, then drain
+					 * the residue below the trigger level (RX timeout) or the
+					 * bytes around a line error by PIO so that errors are
+					 * reported against the right character. If a burst may still
+					 * be in flight, only the bursts before it are passed on and
+					 * the FIFO, whose bytes come after the burst, is left alone:
+					 * the interrupt is still pending and the loop services it
+					 * again.
+					 */
+					InterruptLock(&dev->rx_spinlock);
+					drained = seromap_edma_rx_drain(dev, &end);
+					status |= seromap_edma_rx(dev, end, &cnt);
+					if (drained == 0)
+						status |= rx_fifo(dev, &cnt);
+					seromap_edma_rx_start(dev);
+				}
+				else {
+					status |= rx_fifo(dev, &cnt);
+					InterruptLock(&dev->rx_spinlock);
+				}
+				dev->stats.rx_intr++;
+				dev->stats.rx_bytes += cnt;
+				if (iir == OMAP_II_RXTO)
+					dev->stats.rx_timeout++;
+				if (dev->rx_adaptive)
+					rx_adapt(dev, iir);
+				InterruptUnlock(&dev->rx_spinlock);
 #ifdef WINBT
 				if (cnt && dev->signal_oband_notification) {
 
@@ -165,6 +279,7 @@ ser_intr(void *area, int id)
 
 				// disable thr interrupt
 				set_port(dev->port[OMAP_UART_IER], OMAP_IER_THR, 0);
+				dev->stats.tx_intr++;
 
 				dev->tty.un.s.tx_tmr = 0;
 				/* Send event to io-char, tto() will be processed at thread time */
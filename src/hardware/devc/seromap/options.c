@@ -28,6 +28,11 @@ Options:
  -a           Use auto-rts when hardware flow control is enabled
  -b number    Define initial baud rate (default 115200)
  -c clk[/div] Set the input clock rate and divisor
+ -d [rx][/tx][,irq]
+              Receive and/or transmit through EDMA channels rx and tx.
+              irq is the completion vector of EDMA channel 0 (default
+              0x200), channel n completes on irq + n. Transmit needs a
+              UART with the TX FIFO level register (MVR 5.2 or later)
  -C number    Size of canonical input buffer (default 256)
  -e           Set options to "edit" mode
  -E           Set options to "raw" mode (default)
@@ -38,7 +43,9 @@ Options:
  -O number    Size of output buffer (default 2048)
  -s           Enable software flow control
  -S           Disable software flow control (default)
- -t number    Set receive FIFO trigger level (default 16)
+ -t number|auto
+              Set receive FIFO trigger level (default 16), auto adapts
+              it between 8, 16 and 56 to the receive load
  -T number    Set transmit FIFO trigger level (default 8)
  -u unit      Set serial unit number (default 1)
  -l (0|1)     Enable Loopback mode (1=on, 0=off)
@@ -115,7 +122,11 @@ options(int argc, char *argv[])
 		},
 		0,						// loopback disable
 		0,						// auto_rts_enable
-		0						// modem status interrupt disable
+		0,						// modem status interrupt disable
+		-1,						// EDMA receive channel
+		-1,						// EDMA transmit channel
+		0,						// EDMA completion irq
+		0						// adaptive RX trigger disable
 	};
 
 	unsigned maxim_xcvr_kick = 0;
@@ -126,7 +137,7 @@ options(int argc, char *argv[])
 	unit = 1;
 	while (optind < argc) {
 		// Process dash options.
-		while ((opt = getopt(argc, argv, IO_CHAR_SERIAL_OPTIONS "ac:t:T:U:u:l:M")) != -1) {
+		while ((opt = getopt(argc, argv, IO_CHAR_SERIAL_OPTIONS "ac:d:t:T:U:u:l:M")) != -1) {
 			switch (ttc(TTC_SET_OPTION, &devinit, opt)) {
 			case 'a':
 				devinit.auto_rts_enable = 1;
@@ -136,7 +147,19 @@ options(int argc, char *argv[])
 				if ((cp = strchr(optarg, '/')))
 					devinit.tty.div = strtoul(cp + 1, NULL, 0);
 				break;
+			case 'd':
+				if (*optarg != '/' && *optarg != ',')
+					devinit.edma_rx_chid = strtoul(optarg, &optarg, 0);
+				if (*optarg == '/')
+					devinit.edma_tx_chid = strtoul(optarg + 1, &optarg, 0);
+				if (*optarg == ',')
+					devinit.edma_irq = strtoul(optarg + 1, NULL, 0);
+				break;
 			case 't':
+				if (strcmp(optarg, "auto") == 0) {
+					devinit.rx_adaptive = 1;
+					break;
+				}
 				fifo_rx = strtoul(optarg, NULL, 0);
 				fifo_rx2 = encode_fifo_trigger(fifo_rx);
 				if (0 == fifo_rx2)
@@ -208,8 +231,15 @@ options(int argc, char *argv[])
 			{
 				slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Port ...................... %s (0x%x)", dev->tty.name, dev->port[0]);
 				slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "IRQ ....................... 0x%x", dev->intr);
-				slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Rx fifo trigger ........... %d", fifo_rx);
+				if (dev->rx_adaptive)
+					slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Rx fifo trigger ........... auto");
+				else
+					slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Rx fifo trigger ........... %d", fifo_rx);
 				slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Tx fifo trigger ........... %d", fifo_tx);
+				if (dev->edma_rx)
+					slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Rx EDMA channel ........... %d (irq 0x%x)", dev->edma_rx_chid, dev->edma_rx_irq);
+				if (dev->edma_tx)
+					slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Tx EDMA channel ........... %d (irq 0x%x)", dev->edma_tx_chid, dev->edma_tx_irq);
 				slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Rx flow control highwater . %d", dev->tty.highwater);
 				slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Input buffer size ......... %d", dev->tty.ibuf.size);
 				slogf(_SLOG_SETCODE(_SLOGC_CHAR, 0), _SLOG_INFO, "Output buffer size ........ %d", dev->tty.obuf.size);
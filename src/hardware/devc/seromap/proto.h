@@ -28,8 +28,19 @@ void ser_ctrl(DEV_OMAP *dev, unsigned flags);
 void set_port(unsigned port, unsigned mask, unsigned data);
 void *query_default_device(TTYINIT_OMAP *dip, void *link);
 const struct sigevent *ser_intr(void *area, int id);
+int seromap_tti_bulk(DEV_OMAP *dev, const unsigned char *buf, int n);
+int seromap_devctl(resmgr_context_t *ctp, io_devctl_t *msg, iofunc_ocb_t *ocb);
+void seromap_stats_init(DEV_OMAP *dev);
 unsigned options(int argc, char *argv[]);
 void run_errata_i202(DEV_OMAP *dev);
+int seromap_edma_init(DEV_OMAP *dev, TTYINIT_OMAP *dip);
+void seromap_edma_rx_start(DEV_OMAP *dev);
+void seromap_edma_rx_stop(DEV_OMAP *dev);
+unsigned seromap_edma_rx_pos(DEV_OMAP *dev);
+int seromap_edma_rx_drain(DEV_OMAP *dev, unsigned *end);
+int seromap_edma_rx(DEV_OMAP *dev, unsigned pos, int *cnt);
+int seromap_edma_tx(DEV_OMAP *dev);
+void seromap_edma_tx_pause(DEV_OMAP *dev, int pause);
 
 #ifdef PWR_MAN
 #include <clock_toggle.h>
@@ -30,6 +30,7 @@ tto(TTYDEV *ttydev, int action, int arg1)
 	DEV_OMAP		*dev = (DEV_OMAP *)ttydev;
 	const uintptr_t	*port = dev->port;
 	unsigned char	c;
+	int				free;
 
 #ifdef PWR_MAN
 	if (dev->idle) {
@@ -87,8 +88,46 @@ tto(TTYDEV *ttydev, int action, int arg1)
 		return (0);
 	}
 
-	while (bup->cnt > 0 && (!(read_omap(port[OMAP_UART_SSR]) & OMAP_SSR_TXFULL)))
+	if (dev->tx_busy) {
+		/* EDMA transfer in progress, only honour output flow control */
+		if (dev->tty.flags & (OHW_PAGED | OSW_PAGED) && !(dev->tty.xflags & OSW_PAGED_OVERRIDE))
+			seromap_edma_tx_pause(dev, 1);
+		else
+			seromap_edma_tx_pause(dev, 0);
+		return(tto_checkclients(&dev->tty));
+	}
+
+	/*
+	 * A queued EDMA block keeps going out after a received XOFF, so software
+	 * output flow control (IXON) is only honoured on the PIO path.
+	 */
+	if (dev->edma_tx && bup->cnt >= SEROMAP_TXDMA_MIN && !(dev->tty.c_iflag & IXON) &&
+		!(dev->tty.flags & (OHW_PAGED | OSW_PAGED) || dev->tty.xflags & OSW_PAGED_OVERRIDE)) {
+		if (seromap_edma_tx(dev) == 0 && (dev->tx_busy || bup->cnt == 0))
+			return(tto_checkclients(&dev->tty));
+	}
+
+	/*
+	 * Fill the free space of the TX FIFO in one burst where TXFIFO_LVL
+	 * exists, otherwise check SSR.TXFULL before every character.
+	 */
+	free = 0;
+	dev_lock(&dev->tty);
+	while (bup->cnt > 0)
 	{
+		if (free == 0) {
+#ifndef OMAP5910
+			if (dev->fifo_lvl)
+				free = FIFO_SIZE - read_omap(port[OMAP_UART_TXFIFO_LVL]);
+			else
+#endif
+			if (!(read_omap(port[OMAP_UART_SSR]) & OMAP_SSR_TXFULL))
+				free = 1;
+			if (free == 0)
+				break;
+		}
+		free--;
+
 		/*
 		 * If the OSW_PAGED_OVERRIDE flag is set then allow
 		 * transmit of character even if output is suspended via
@@ -102,9 +141,7 @@ tto(TTYDEV *ttydev, int action, int arg1)
 			break;
 
 		/* Get character from obuf and do any output processing */
-		dev_lock(&dev->tty);
 		c = tto_getchar(&dev->tty);
-		dev_unlock(&dev->tty);
 
 		/* Print the character */
 		dev->tty.un.s.tx_tmr = 3;	/* Timeout 3 */
@@ -118,6 +155,7 @@ tto(TTYDEV *ttydev, int action, int arg1)
 			break;
 		}
 	}
+	dev_unlock(&dev->tty);
 
 	/* If there is still data in the obuf and we are not in a flow
 	 * controlled state then turn TX interrupts back on to notify us
@@ -133,6 +171,20 @@ tto(TTYDEV *ttydev, int action, int arg1)
 	return(tto_checkclients(&dev->tty));
 }
 
+/*
+ * Enter a configuration mode (DLAB set). dev->lcr is updated under rx_spinlock
+ * so that the adaptive RX trigger in the ISR does not write FCR, which is EFR
+ * in configuration mode B, until ser_stty() restores the operational LCR.
+ */
+static void
+ser_lcr_config(DEV_OMAP *dev, unsigned char mode)
+{
+	InterruptLock(&dev->rx_spinlock);
+	dev->lcr = mode;
+	write_omap(dev->port[OMAP_UART_LCR], mode);
+	InterruptUnlock(&dev->rx_spinlock);
+}
+
 void
 ser_stty(DEV_OMAP *dev)
 {
@@ -174,7 +226,7 @@ ser_stty(DEV_OMAP *dev)
 	if (dev->efr != efr)
 	{
 		/* Switch to Config mode B to access the Enhanced Feature Register (EFR) */
-		write_omap(port[OMAP_UART_LCR],0xbf);
+		ser_lcr_config(dev, 0xbf);
 		/* turn off S/W flow control, Config AUTO hw flow control, enable writes to MCR[7:5], FCR[5:4], and IER[7:4] */
 		set_port(port[OMAP_UART_EFR], efr, efr);
 		/* Switch back to operational mode */
@@ -188,7 +240,7 @@ ser_stty(DEV_OMAP *dev)
 	if (dev->tty.baud != dev->baud)
 	{
 		/* Get acces to Divisor Latch registers */
-		write_omap(port[OMAP_UART_LCR], OMAP_LCR_DLAB);
+		ser_lcr_config(dev, OMAP_LCR_DLAB);
 
 #ifdef OMAP5910
 		/*
@@ -240,6 +292,10 @@ ser_stty(DEV_OMAP *dev)
 			set_port(port[OMAP_UART_MDR1], OMAP_MDR1_MODE_MSK, OMAP_MDR1_MODE_16X); /* Enable UART in 16x mode */
 
 		run_errata_i202(dev);
+
+		/* Clearing the FIFOs rewrote FCR, restore the adaptive RX trigger */
+		if (dev->rx_adaptive)
+			write_omap(port[OMAP_UART_FCR], OMAP_FCR_ENABLE | OMAP_FCR_RXTRIG(dev->rx_level));
 #endif
 		dev->lcr = lcr;
 		dev->baud = dev->tty.baud;
@@ -274,7 +330,7 @@ int drain_check(TTYDEV *ttydev, uintptr_t *count)
 #endif
 
 	// if the device has DRAINED, return 1
-	if (bup->cnt == 0 &&
+	if (bup->cnt == 0 && !dev->tx_busy &&
 		(read_omap(port[OMAP_UART_LSR]) & OMAP_LSR_TSRE)) return 1;
 
 	// if the device has not DRAINED, set a timer based on 50ms counts
@@ -101,6 +101,7 @@
 // these are not overridden
 #define OMAP_I2C_WE       0x34
 #define OMAP_I2C_BUFSTAT  0xc0
+#define OMAP_I2C_IE_CLR   0x30
 
 #endif
 
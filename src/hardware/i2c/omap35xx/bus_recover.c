@@ -19,10 +19,58 @@
  * $
  */
 
+#include <time.h>
 #include "proto.h"
 
+#define OMAP_I2C_RECOVER_CLOCKS	9
+#define OMAP_I2C_RECOVER_HALF_NS	5000	/* 100kHz */
+
+#define SYSTEST_IO	(OMAP_I2C_SYSTEST_ST_EN | OMAP_I2C_SYSTEST_TMODE_IO)
+
+static void
+recover_drive(omap_dev_t *dev, unsigned val)
+{
+	out16(dev->regbase + OMAP_I2C_SYSTEST, SYSTEST_IO | val);
+	nanospin_ns(OMAP_I2C_RECOVER_HALF_NS);
+}
+
+/*
+ * A slave that lost track of the transfer may hold SDA low. Take the pins
+ * over through the test mode, clock SCL until the slave releases SDA and
+ * finish with a STOP condition.
+ */
 int omap_i2c_bus_recover(omap_dev_t *dev) {
-	return 0;
+	int		i;
+	int		ret = 0;
+
+	omap_clock_enable(dev);
+	dev->stats.recoveries++;
+
+	/* release both lines */
+	recover_drive(dev, OMAP_I2C_SYSTEST_SCL_O | OMAP_I2C_SYSTEST_SDA_O);
+
+	for (i = 0; i < OMAP_I2C_RECOVER_CLOCKS; i++) {
+		if (in16(dev->regbase + OMAP_I2C_SYSTEST) & OMAP_I2C_SYSTEST_SDA_I_FUNC) {
+			break;
+		}
+		recover_drive(dev, OMAP_I2C_SYSTEST_SDA_O);
+		recover_drive(dev, OMAP_I2C_SYSTEST_SCL_O | OMAP_I2C_SYSTEST_SDA_O);
+	}
+
+	/* STOP: SDA low to high while SCL is high */
+	recover_drive(dev, 0);
+	recover_drive(dev, OMAP_I2C_SYSTEST_SCL_O);
+	recover_drive(dev, OMAP_I2C_SYSTEST_SCL_O | OMAP_I2C_SYSTEST_SDA_O);
+
+	if (!(in16(dev->regbase + OMAP_I2C_SYSTEST) & OMAP_I2C_SYSTEST_SDA_I_FUNC)) {
+		dev->stats.recover_fail++;
+		ret = -1;
+	}
+
+	out16(dev->regbase + OMAP_I2C_SYSTEST, 0);
+	omap_clock_disable(dev);
+
+	return ret;
 }
 
 #if defined(__QNXNTO__) && defined(__USESRCVERSION)
@@ -19,28 +19,235 @@
  * $
  */
 
+#include <time.h>
+#include <sys/slog.h>
+#include <sys/slogcodes.h>
 #include "proto.h"
+#include "context_restore.h"
+
+#define CLKCTRL_MODULEMODE_MASK		0x3
+#define CLKCTRL_MODULEMODE_ENABLE	0x2
+#define CLKCTRL_IDLEST_MASK			(0x3 << 16)
+#define CLKCTRL_IDLEST_DISABLED		(0x3 << 16)
+#define CLKCTRL_TIMEOUT				1000	/* IDLEST polls, 1us apart */
+
+#define OMAP_I2C_CLK_EVENT			1
+
+/*
+ * Module clock control. Every register access is bracketed by
+ * omap_clock_enable()/omap_clock_disable(), which only count references.
+ * The clock is gated once the last reference has been dropped and the
+ * driver has stayed idle for clk_idle ms, so back to back transfers run
+ * on an already running module.
+ */
+
+static void
+clock_hw_on(omap_dev_t *dev)
+{
+	int		timeout = CLKCTRL_TIMEOUT;
+
+	if (dev->clkctrl_base) {
+		out32(dev->clkctrl_base, (in32(dev->clkctrl_base) & ~CLKCTRL_MODULEMODE_MASK) | CLKCTRL_MODULEMODE_ENABLE);
+		while ((in32(dev->clkctrl_base) & CLKCTRL_IDLEST_MASK) && --timeout) {
+			nanospin_ns(1000);
+		}
+		if (timeout == 0) {
+			slogf(_SLOGC_I2C, _SLOG_ERROR, "i2c-omap35xx: module did not leave idle, CLKCTRL %x",
+				in32(dev->clkctrl_base));
+		}
+		dev->clkctrl_disabled = 0;
+	}
+	dev->clk_on = 1;
+	dev->stats.clk_on++;
+	context_restore(dev);
+}
+
+static void
+clock_hw_off(omap_dev_t *dev)
+{
+	int		timeout = CLKCTRL_TIMEOUT;
+
+	context_restore_save(dev);
+	dev->clk_on = 0;
+	if (dev->clkctrl_base) {
+		/* the ISR must not touch the module from here on */
+		dev->clkctrl_disabled = 1;
+		out32(dev->clkctrl_base, in32(dev->clkctrl_base) & ~CLKCTRL_MODULEMODE_MASK);
+		while ((in32(dev->clkctrl_base) & CLKCTRL_IDLEST_MASK) != CLKCTRL_IDLEST_DISABLED && --timeout) {
+			nanospin_ns(1000);
+		}
+	}
+	dev->stats.clk_off++;
+}
 
 void
 omap_clock_enable(omap_dev_t* dev)
 {
-
+	pthread_mutex_lock(&dev->clk_mutex);
+	if (dev->clk_refs++ == 0 && !dev->clk_on) {
+		clock_hw_on(dev);
+	}
+	pthread_mutex_unlock(&dev->clk_mutex);
 }
 
 void
 omap_clock_disable(omap_dev_t* dev)
 {
+	struct itimerspec	itime;
+
+	pthread_mutex_lock(&dev->clk_mutex);
+	if (dev->clk_refs > 0 && --dev->clk_refs == 0) {
+		if (dev->clk_idle == 0 || dev->clk_tid == -1) {
+			clock_hw_off(dev);
+		} else {
+			/* (re)start the idle period */
+			memset(&itime, 0, sizeof(itime));
+			nsec2timespec(&itime.it_value, (uint64_t)dev->clk_idle * 1000000);
+			timer_settime(dev->clk_timer, 0, &itime, NULL);
+		}
+	}
+	pthread_mutex_unlock(&dev->clk_mutex);
+}
 
+/*
+ * A transfer that ended without STOP leaves the bus to the repeated START
+ * that follows, the module must not be gated (and lose CON) in between.
+ * Called with the transfer's own reference still held: takes an extra
+ * reference while re_start is set and drops it once the STOP was sent or
+ * the ISR aborted the transaction.
+ */
+void
+omap_clock_restart(omap_dev_t* dev)
+{
+	pthread_mutex_lock(&dev->clk_mutex);
+	if (dev->re_start && !dev->clk_restart) {
+		dev->clk_restart = 1;
+		dev->clk_refs++;
+	} else if (!dev->re_start && dev->clk_restart) {
+		dev->clk_restart = 0;
+		dev->clk_refs--;
+	}
+	pthread_mutex_unlock(&dev->clk_mutex);
+}
+
+static void *
+clock_idle_thread(void *arg)
+{
+	omap_dev_t		*dev = arg;
+	struct _pulse	pulse;
+
+	while (1) {
+		if (MsgReceivePulse(dev->clk_chid, &pulse, sizeof(pulse), NULL) == -1) {
+			continue;
+		}
+		if (pulse.code != OMAP_I2C_CLK_EVENT) {
+			continue;
+		}
+		pthread_mutex_lock(&dev->clk_mutex);
+		if (dev->clk_refs == 0 && dev->clk_on) {
+			clock_hw_off(dev);
+		}
+		pthread_mutex_unlock(&dev->clk_mutex);
+	}
+
+	return NULL;
 }
 
 int
 omap_clock_toggle_init(omap_dev_t* dev)
 {
+	struct sigevent		event;
+
 	dev->clkctrl_base = 0;
-	dev->clkctrl_phys = 0;
 	dev->clkstctrl_base = 0;
 	dev->clkctrl_disabled = 0;
+	dev->clk_on = 0;
+	dev->clk_refs = 0;
+	dev->clk_restart = 0;
+	dev->clk_tid = -1;
+	dev->clk_chid = -1;
+	dev->clk_coid = -1;
+
+	if (pthread_mutex_init(&dev->clk_mutex, NULL) != EOK) {
+		return -1;
+	}
+
+#ifdef VARIANT_omap4
+	/* clocks are managed outside of the driver */
+	if (dev->no_powmgm) {
+		dev->clkctrl_phys = 0;
+	}
+#endif
+	if (dev->clkctrl_phys) {
+		dev->clkctrl_base = mmap_device_io(4, dev->clkctrl_phys);
+		if (dev->clkctrl_base == (uintptr_t)MAP_FAILED) {
+			perror("mmap_device_io");
+			dev->clkctrl_base = 0;
+			goto fail;
+		}
+	}
+
+	if (dev->clk_idle == 0) {
+		return 0;
+	}
+
+	if ((dev->clk_chid = ChannelCreate(_NTO_CHF_PRIVATE)) == -1) {
+		perror("ChannelCreate");
+		goto fail;
+	}
+	if ((dev->clk_coid = ConnectAttach(0, 0, dev->clk_chid, _NTO_SIDE_CHANNEL, 0)) == -1) {
+		perror("ConnectAttach");
+		goto fail;
+	}
+
+	SIGEV_PULSE_INIT(&event, dev->clk_coid, dev->intr_priority, OMAP_I2C_CLK_EVENT, 0);
+	if (timer_create(CLOCK_MONOTONIC, &event, &dev->clk_timer) == -1) {
+		perror("timer_create");
+		goto fail;
+	}
+
+	if (pthread_create(&dev->clk_tid, NULL, clock_idle_thread, dev) != EOK) {
+		dev->clk_tid = -1;
+		timer_delete(dev->clk_timer);
+		goto fail;
+	}
+
 	return 0;
+
+fail:
+	omap_clock_toggle_fini(dev);
+	return -1;
+}
+
+void
+omap_clock_toggle_fini(omap_dev_t* dev)
+{
+	if (dev->clk_tid != -1) {
+		pthread_cancel(dev->clk_tid);
+		pthread_join(dev->clk_tid, NULL);
+		timer_delete(dev->clk_timer);
+		dev->clk_tid = -1;
+	}
+	if (dev->clk_coid != -1) {
+		ConnectDetach(dev->clk_coid);
+		dev->clk_coid = -1;
+	}
+	if (dev->clk_chid != -1) {
+		ChannelDestroy(dev->clk_chid);
+		dev->clk_chid = -1;
+	}
+
+	pthread_mutex_lock(&dev->clk_mutex);
+	if (dev->clk_on) {
+		clock_hw_off(dev);
+	}
+	pthread_mutex_unlock(&dev->clk_mutex);
+	pthread_mutex_destroy(&dev->clk_mutex);
+
+	if (dev->clkctrl_base) {
+		munmap_device_io(dev->clkctrl_base, 4);
+		dev->clkctrl_base = 0;
+	}
 }
 
 #if defined(__QNXNTO__) && defined(__USESRCVERSION)
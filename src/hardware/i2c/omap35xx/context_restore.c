@@ -20,32 +20,95 @@
  */
 
 #include "proto.h"
+#include "context_restore.h"
 
 int
 context_restore_init(omap_dev_t *dev)
 {
 	dev->state.captured = 0;
 	dev->i2c_context_vaddr = 0;
-	dev->i2c_context_paddr = 0;
+
+	/* PRM context register given with -x */
+	if (dev->i2c_context_paddr) {
+		dev->i2c_context_vaddr = mmap_device_io(4, dev->i2c_context_paddr);
+		if (dev->i2c_context_vaddr == (uintptr_t)MAP_FAILED) {
+			dev->i2c_context_vaddr = 0;
+			perror("mmap_device_io");
+			return -1;
+		}
+		out32(dev->i2c_context_vaddr, LOSTCONTEXT_DFF_MASK | LOSTCONTEXT_RFF_MASK);
+	}
 	return 0;
 }
 
 void
 context_restore_fini(omap_dev_t *dev)
 {
-
+	if (dev->i2c_context_vaddr) {
+		munmap_device_io(dev->i2c_context_vaddr, 4);
+		dev->i2c_context_vaddr = 0;
+	}
 }
 
+/*
+ * Called with the module still clocked, right before it is gated.
+ */
 void
 context_restore_save(omap_dev_t *dev)
 {
+	dev->state.ie = in16(dev->regbase + OMAP_I2C_IE);
+	dev->state.psc = in16(dev->regbase + OMAP_I2C_PSC);
+	dev->state.scll = in16(dev->regbase + OMAP_I2C_SCLL);
+	dev->state.sclh = in16(dev->regbase + OMAP_I2C_SCLH);
+	dev->state.buf = in16(dev->regbase + OMAP_I2C_BUF);
+	dev->state.sysc = in16(dev->regbase + OMAP_I2C_SYSC);
+	dev->state.we = in16(dev->regbase + OMAP_I2C_WE);
+	dev->state.captured = 1;
 
+	/* start over with a clean lost context indication */
+	if (dev->i2c_context_vaddr) {
+		out32(dev->i2c_context_vaddr, LOSTCONTEXT_DFF_MASK | LOSTCONTEXT_RFF_MASK);
+	}
 }
 
+static int
+context_lost(omap_dev_t *dev)
+{
+	if (dev->i2c_context_vaddr) {
+		return (in32(dev->i2c_context_vaddr) & (LOSTCONTEXT_DFF_MASK | LOSTCONTEXT_RFF_MASK));
+	}
+
+	/* without the PRM context register, reset values give it away */
+	return (in16(dev->regbase + OMAP_I2C_PSC) != dev->state.psc ||
+			in16(dev->regbase + OMAP_I2C_SCLL) != dev->state.scll ||
+			in16(dev->regbase + OMAP_I2C_SCLH) != dev->state.sclh);
+}
+
+/*
+ * Called right after the module clock was ungated.
+ */
 void
 context_restore(omap_dev_t *dev)
 {
+	if (!dev->state.captured || !context_lost(dev)) {
+		return;
+	}
+
+	out16(dev->regbase + OMAP_I2C_CON, 0);
+	out16(dev->regbase + OMAP_I2C_SYSC, dev->state.sysc);
+	out16(dev->regbase + OMAP_I2C_WE, dev->state.we);
+	out16(dev->regbase + OMAP_I2C_PSC, dev->state.psc);
+	out16(dev->regbase + OMAP_I2C_SCLL, dev->state.scll);
+	out16(dev->regbase + OMAP_I2C_SCLH, dev->state.sclh);
+	out16(dev->regbase + OMAP_I2C_BUF, dev->state.buf | OMAP_I2C_BUF_RXFIF_CLR | OMAP_I2C_BUF_TXFIF_CLR);
+	out16(dev->regbase + OMAP_I2C_OA, dev->own_addr);
+	out16(dev->regbase + OMAP_I2C_CON, OMAP_I2C_CON_EN);
+	out16(dev->regbase + OMAP_I2C_IE, dev->state.ie);
 
+	if (dev->i2c_context_vaddr) {
+		out32(dev->i2c_context_vaddr, LOSTCONTEXT_DFF_MASK | LOSTCONTEXT_RFF_MASK);
+	}
+	dev->stats.ctx_restores++;
 }
 
 #if defined(__QNXNTO__) && defined(__USESRCVERSION)
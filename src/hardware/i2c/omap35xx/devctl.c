@@ -0,0 +1,64 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2014, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#include "proto.h"
+
+static int
+omap_stats(omap_dev_t *dev, omap_i2c_stats_t *st)
+{
+	uint32_t	flags = st->flags;
+
+	/* the clock counters are also updated by the idle thread */
+	pthread_mutex_lock(&dev->clk_mutex);
+	*st = dev->stats;
+	st->flags = flags;
+	if (flags & OMAP_I2C_STATS_CLR) {
+		memset(&dev->stats, 0, sizeof(dev->stats));
+	}
+	pthread_mutex_unlock(&dev->clk_mutex);
+	return EOK;
+}
+
+int
+omap_devctl(void *hdl, int cmd, void *msg, int msglen, int *nbytes, int *info)
+{
+	omap_dev_t		*dev = hdl;
+
+	switch (cmd) {
+		case DCMD_I2C_OMAP_STATS:
+			if (msglen < sizeof(omap_i2c_stats_t)) {
+				return EINVAL;
+			}
+			*nbytes = sizeof(omap_i2c_stats_t);
+			return omap_stats(dev, msg);
+
+		case DCMD_I2C_OMAP_XFER:
+			*nbytes = msglen;
+			return omap_xfer(dev, msg, msglen);
+	}
+
+	return ENOSYS;
+}
+
+#if defined(__QNXNTO__) && defined(__USESRCVERSION)
+#include <sys/srcversion.h>
+__SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/i2c/omap35xx/devctl.c $ $Rev: 765543 $")
+#endif
@@ -0,0 +1,267 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2014, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#include <sys/slog.h>
+#include <sys/slogcodes.h>
+#include <sys/rsrcdbmgr.h>
+#include <arm/dm6446.h>
+#include "proto.h"
+
+#define OPT_TCINTEN		(1 << 20)
+#define OPT_TCC(x)		((x) << 12)
+
+#define DMA_DATA_IE		(OMAP_I2C_IE_XRDY | OMAP_I2C_IE_RRDY | OMAP_I2C_IE_XDR | OMAP_I2C_IE_RDR)
+#define DMA_DONE_SPIN	1000	/* IPR reads after ARDY for the last RX byte */
+
+static inline void
+edma_setbit(uintptr_t base, int reg, int bit)
+{
+	if (bit > 31)
+		reg += 4, bit -= 32;
+
+	out32(base + reg, (1 << bit));
+}
+
+static inline int
+edma_testbit(uintptr_t base, int reg, int bit)
+{
+	if (bit > 31)
+		reg += 4, bit -= 32;
+
+	return (in32(base + reg) & (1 << bit));
+}
+
+static edma_t *
+edma_param(omap_dev_t *dev, int set)
+{
+	return ((edma_t *)(dev->edma_vbase + DM6446_EDMA_PARAM_BASE + (0x20 * set)));
+}
+
+/*
+ * Program the channel once per bus. Each I2C DMA request moves one byte
+ * (A-synchronized, the FIFO thresholds are 1 while EDMA runs) between the
+ * DATA register and the bounce buffer. The channel set links to a copy of
+ * itself, so after a transfer only the byte count has to be written.
+ */
+static void
+edma_setup(omap_dev_t *dev, int chid, int rx)
+{
+	uint32_t	fifo = dev->physbase + OMAP_I2C_DATA;
+	edma_t		*param = edma_param(dev, chid + OMAP_I2C_EDMA_RELOAD);
+
+	param->opt         = OPT_TCINTEN | OPT_TCC(chid);
+	param->src         = rx ? fifo : dev->dma_pbuf;
+	param->abcnt       = (0 << 16) | 1;
+	param->dst         = rx ? dev->dma_pbuf : fifo;
+	param->srcdstbidx  = rx ? (1 << 16) | 0 : (0 << 16) | 1;
+	param->linkbcntrld = DM6446_EDMA_PARAM_BASE + (0x20 * (chid + OMAP_I2C_EDMA_RELOAD));
+	param->srcdstcidx  = 0;
+	param->ccnt        = 1;
+
+	memcpy((void *)edma_param(dev, chid), (void *)param, sizeof(edma_t));
+
+	/* completion is polled from IPR, no EDMA interrupt */
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_EECR, chid);
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_IECR, chid);
+	edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_ICR,  chid);
+}
+
+static int
+edma_channel_attach(int chid)
+{
+	rsrc_request_t	req = { 0 };
+
+	req.length = 1;
+	req.start = req.end = chid;
+	req.flags = RSRCDBMGR_DMA_CHANNEL | RSRCDBMGR_FLAG_RANGE;
+	if (rsrcdbmgr_attach(&req, 1) == -1) {
+		slogf(_SLOGC_I2C, _SLOG_ERROR, "i2c-omap35xx: Unable to acquire EDMA channel %d (%d)", chid, errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+edma_channel_detach(int chid)
+{
+	rsrc_request_t	req = { 0 };
+
+	req.length = 1;
+	req.start = req.end = chid;
+	req.flags = RSRCDBMGR_DMA_CHANNEL | RSRCDBMGR_FLAG_RANGE;
+	rsrcdbmgr_detach(&req, 1);
+}
+
+int
+omap_dma_use(omap_dev_t *dev, unsigned len, int rx)
+{
+	if (!dev->edma_vbase || len < dev->dma_min || len > OMAP_I2C_DMA_SIZE) {
+		return 0;
+	}
+
+	return ((rx ? dev->edma_rx_chid : dev->edma_tx_chid) != -1);
+}
+
+/*
+ * Called with CNT set and the FIFOs cleared, before the START.
+ */
+void
+omap_dma_start(omap_dev_t *dev, void *buf, unsigned len, int rx)
+{
+	uintptr_t	region0base = dev->edma_vbase + DM6446_EDMA_REGION0;
+	int			chid = rx ? dev->edma_rx_chid : dev->edma_tx_chid;
+	uint16_t	bufreg;
+
+	if (!rx) {
+		memcpy(dev->dma_buf, buf, len);
+	}
+
+	edma_param(dev, chid)->abcnt = (len << 16) | 1;
+
+	edma_setbit(region0base, DM6446_EDMA_ECR,  chid);
+	edma_setbit(region0base, DM6446_EDMA_SECR, chid);
+	edma_setbit(dev->edma_vbase, DM6446_EDMA_EMCR, chid);
+	edma_setbit(region0base, DM6446_EDMA_ICR,  chid);
+	edma_setbit(region0base, DM6446_EDMA_EESR, chid);
+
+	dev->dma_active = 1;
+	omap_intr_disable(dev, DMA_DATA_IE);
+
+	bufreg = in16(dev->regbase + OMAP_I2C_BUF) & ~(OMAP_I2C_BUF_RTRSH | OMAP_I2C_BUF_XTRSH);
+	out16(dev->regbase + OMAP_I2C_BUF, bufreg | (rx ? OMAP_I2C_BUF_RDMA_EN : OMAP_I2C_BUF_XDMA_EN));
+}
+
+/*
+ * Called once the controller signalled completion. Returns the status of
+ * the transfer, a short EDMA transfer turns a success into an error.
+ */
+uint32_t
+omap_dma_finish(omap_dev_t *dev, void *buf, unsigned len, int rx, uint32_t status)
+{
+	uintptr_t	region0base = dev->edma_vbase + DM6446_EDMA_REGION0;
+	int			chid = rx ? dev->edma_rx_chid : dev->edma_tx_chid;
+	int			spin = DMA_DONE_SPIN;
+	int			done;
+
+	/* ARDY may come just before the EDMA has read the last byte */
+	while (!(done = edma_testbit(region0base, DM6446_EDMA_IPR, chid)) &&
+		!(status & (I2C_STATUS_NACK | I2C_STATUS_ARBL | I2C_STATUS_ERROR)) && --spin)
+		;
+
+	edma_setbit(region0base, DM6446_EDMA_EECR, chid);
+	edma_setbit(region0base, DM6446_EDMA_ICR,  chid);
+	if (!done) {
+		/* reload the set so the next transfer starts clean */
+		memcpy((void *)edma_param(dev, chid), (void *)edma_param(dev, chid + OMAP_I2C_EDMA_RELOAD), sizeof(edma_t));
+	}
+
+	out16(dev->regbase + OMAP_I2C_BUF, (dev->fifo_size - 1) << 8 | (dev->fifo_size - 1) |
+				OMAP_I2C_BUF_RXFIF_CLR | OMAP_I2C_BUF_TXFIF_CLR);
+	dev->dma_active = 0;
+	out16(dev->regbase + OMAP_I2C_IE, in16(dev->regbase + OMAP_I2C_IE) | DMA_DATA_IE);
+
+	if (done) {
+		dev->stats.dma_xfers++;
+		if (rx) {
+			memcpy(buf, dev->dma_buf, len);
+		}
+	} else if (!(status & (I2C_STATUS_NACK | I2C_STATUS_ARBL | I2C_STATUS_ERROR))) {
+		status |= I2C_STATUS_ERROR;
+	}
+
+	return status;
+}
+
+int
+omap_dma_init(omap_dev_t *dev)
+{
+	if (dev->edma_tx_chid == -1 && dev->edma_rx_chid == -1) {
+		return 0;
+	}
+
+	dev->edma_vbase = (uintptr_t)mmap_device_memory(0, DM6446_EDMA_SIZE,
+				PROT_READ | PROT_WRITE | PROT_NOCACHE, 0, OMAP_I2C_EDMA_BASE);
+	if (dev->edma_vbase == (uintptr_t)MAP_FAILED) {
+		slogf(_SLOGC_I2C, _SLOG_ERROR, "i2c-omap35xx: Unable to map EDMA (%d)", errno);
+		dev->edma_vbase = 0;
+		return -1;
+	}
+
+	dev->dma_buf = mmap(0, OMAP_I2C_DMA_SIZE, PROT_READ | PROT_WRITE | PROT_NOCACHE,
+				MAP_ANON | MAP_PHYS | MAP_PRIVATE, NOFD, 0);
+	if (dev->dma_buf == MAP_FAILED) {
+		slogf(_SLOGC_I2C, _SLOG_ERROR, "i2c-omap35xx: Allocation of EDMA buffer failed (%d)", errno);
+		goto fail;
+	}
+	dev->dma_pbuf = mphys(dev->dma_buf);
+
+	if (dev->edma_tx_chid != -1) {
+		if (edma_channel_attach(dev->edma_tx_chid) == -1) {
+			goto fail1;
+		}
+		edma_setup(dev, dev->edma_tx_chid, 0);
+	}
+	if (dev->edma_rx_chid != -1) {
+		if (edma_channel_attach(dev->edma_rx_chid) == -1) {
+			goto fail2;
+		}
+		edma_setup(dev, dev->edma_rx_chid, 1);
+	}
+
+	return 0;
+
+fail2:
+	if (dev->edma_tx_chid != -1) {
+		edma_channel_detach(dev->edma_tx_chid);
+	}
+fail1:
+	munmap(dev->dma_buf, OMAP_I2C_DMA_SIZE);
+fail:
+	munmap_device_memory((void *)dev->edma_vbase, DM6446_EDMA_SIZE);
+	dev->edma_vbase = 0;
+	return -1;
+}
+
+void
+omap_dma_fini(omap_dev_t *dev)
+{
+	if (!dev->edma_vbase) {
+		return;
+	}
+
+	if (dev->edma_tx_chid != -1) {
+		edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_EECR, dev->edma_tx_chid);
+		edma_channel_detach(dev->edma_tx_chid);
+	}
+	if (dev->edma_rx_chid != -1) {
+		edma_setbit(dev->edma_vbase + DM6446_EDMA_REGION0, DM6446_EDMA_EECR, dev->edma_rx_chid);
+		edma_channel_detach(dev->edma_rx_chid);
+	}
+	munmap(dev->dma_buf, OMAP_I2C_DMA_SIZE);
+	munmap_device_memory((void *)dev->edma_vbase, DM6446_EDMA_SIZE);
+	dev->edma_vbase = 0;
+}
+
+#if defined(__QNXNTO__) && defined(__USESRCVERSION)
+#include <sys/srcversion.h>
+__SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/i2c/omap35xx/dma.c $ $Rev: 765543 $")
+#endif
@@ -35,9 +35,8 @@ omap_fini(void *hdl)
 	ConnectDetach(dev->coid);
 	ChannelDestroy(dev->chid);
 
-	if (dev->clkctrl_base) {
-		munmap_device_io (dev->clkctrl_base, 4);
-	}
+	omap_dma_fini(dev);
+	omap_clock_toggle_fini(dev);
 
 	if (dev->clkstctrl_base) {
 		munmap_device_io (dev->clkstctrl_base, 4);
@@ -144,6 +144,16 @@ omap_init(int argc, char *argv[])
 	dev->intrevent.sigev_code     = OMAP_I2C_EVENT;
 	dev->intrevent.sigev_priority = dev->intr_priority;
 
+	dev->bfevent = dev->intrevent;
+	dev->bfevent.sigev_code       = OMAP_I2C_BF_EVENT;
+	dev->bfexpected = 0;
+	dev->segs = NULL;
+	dev->nsegs = 0;
+	dev->seg = 0;
+	dev->edma_vbase = 0;
+	dev->dma_active = 0;
+	memset(&dev->stats, 0, sizeof(dev->stats));
+
 	/*
 	 * Attach interrupt
 	 */
@@ -175,11 +185,18 @@ omap_init(int argc, char *argv[])
 
 	if (omap_i2c_reset(dev) == -1) {
 		fprintf(stderr, "omap_i2c_reset: reset I2C interface failed\n");
-		goto fail_ctxt_rest;
+		goto fail_clk_fini;
+	}
+
+	/* fall back to PIO if EDMA is not available */
+	if (omap_dma_init(dev) == -1) {
+		dev->edma_tx_chid = dev->edma_rx_chid = -1;
 	}
 
     return dev;
 
+fail_clk_fini:
+    omap_clock_toggle_fini(dev);
 fail_ctxt_rest:
     context_restore_fini(dev);
 fail_intr_dtch:
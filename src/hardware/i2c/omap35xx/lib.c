@@ -40,6 +40,8 @@ i2c_master_getfuncs(i2c_master_funcs_t *funcs, int tabsize)
             version_info, omap_version_info, tabsize);
     I2C_ADD_FUNC(i2c_master_funcs_t, funcs,
             driver_info, omap_driver_info, tabsize);
+    I2C_ADD_FUNC(i2c_master_funcs_t, funcs,
+            ctl, omap_devctl, tabsize);
     I2C_ADD_FUNC(i2c_master_funcs_t, funcs,
             bus_reset, omap_bus_reset, tabsize);
     return 0;
@@ -28,9 +28,9 @@
 
 #ifdef VARIANT_omap4
     #include "clock_toggle.h"
-    #define OPTION_STR          "a:c:ei:p:P:s:vh:l:f"
+    #define OPTION_STR          "a:b:c:eg:i:k:p:P:s:vh:l:fx:"
 #else
-    #define OPTION_STR          "a:i:p:P:s:vh:l:f"
+    #define OPTION_STR          "a:b:d:g:i:k:p:P:s:vh:l:fx:"
 #endif
 
 int
@@ -51,6 +51,13 @@ omap_options(omap_dev_t *dev, int argc, char *argv[])
     dev->slave_addr = TWL4030_AUDIO_SLAVE_ADDRESS; /* audio codec */
     dev->options = 0;
 	dev->re_start = 0;
+    dev->bb_timeout = OMAP_I2C_BB_TIMEOUT;
+    dev->clk_idle = OMAP_I2C_CLK_IDLE;
+    dev->clkctrl_phys = 0;
+    dev->i2c_context_paddr = 0;
+    dev->edma_tx_chid = -1;
+    dev->edma_rx_chid = -1;
+    dev->dma_min = OMAP_I2C_DMA_MIN;
     dev->high_adjust_fast = 0;
     dev->high_adjust_slow = 0;
     dev->low_adjust_fast = 0;
@@ -67,6 +74,13 @@ omap_options(omap_dev_t *dev, int argc, char *argv[])
 		case 'a':
             dev->own_addr = strtoul(optarg, &optarg, NULL);
             break;
+
+        case 'b':
+            dev->bb_timeout = strtoul(optarg, &optarg, NULL);
+            if (dev->bb_timeout == 0) {
+                dev->bb_timeout = OMAP_I2C_BB_TIMEOUT;
+            }
+            break;
 #ifdef VARIANT_omap4
         case 'c':
             dev->soc_version = strtol(optarg, &optarg, NULL);
@@ -77,10 +91,28 @@ omap_options(omap_dev_t *dev, int argc, char *argv[])
                 return -1;
             }
             break;
+#else
+        /* EDMA at 0x49000000 is j5 only, that is L4 on OMAP4 */
+        case 'd':
+            dev->edma_tx_chid = strtol(optarg, &optarg, 0);
+            if (*optarg == '/')
+                dev->edma_rx_chid = strtol(optarg + 1, &optarg, 0);
+            if (*optarg == ',')
+                dev->dma_min = strtoul(optarg + 1, &optarg, 0);
+            break;
 #endif
+
+        case 'g':
+            dev->clk_idle = strtoul(optarg, &optarg, NULL);
+            break;
+
         case 'i':
             dev->intr = strtol(optarg, &optarg, NULL);
             break;
+
+        case 'k':
+            dev->clkctrl_phys = strtoul(optarg, &optarg, NULL);
+            break;
 #ifdef VARIANT_omap4
 		case 'e':
 			// No power management support
@@ -130,6 +162,10 @@ omap_options(omap_dev_t *dev, int argc, char *argv[])
             dev->options |= OMAP_OPT_ROVR_XUDF_OK;
             break;
 
+        case 'x':
+            dev->i2c_context_paddr = strtoul(optarg, &optarg, NULL);
+            break;
+
         case '?':
             if (optopt == '-') {
                 ++optind;
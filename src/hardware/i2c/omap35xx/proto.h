@@ -29,14 +29,28 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/neutrino.h>
 #include <sys/mman.h>
 #include <hw/inout.h>
 #include <hw/i2c.h>
+#include <hw/i2c-omap35xx.h>
 #include <arm/omap.h>
 #include <arm/omap3530.h>
 #include "offsets.h"
 
+typedef struct {
+    volatile uint32_t   opt;
+    volatile uint32_t   src;
+    volatile uint32_t   abcnt;
+    volatile uint32_t   dst;
+    volatile uint32_t   srcdstbidx;
+    volatile uint32_t   linkbcntrld;
+    volatile uint32_t   srcdstcidx;
+    volatile uint32_t   ccnt;
+} edma_t;
+
 typedef struct _omap_dev {
     unsigned            reglen;
     uintptr_t           regbase;
@@ -46,6 +60,15 @@ typedef struct _omap_dev {
     unsigned            clkctrl_phys;
     uintptr_t           clkstctrl_base;
     unsigned            clkctrl_disabled;
+    unsigned            clk_on;
+    int                 clk_refs;
+    unsigned            clk_idle;       /* idle time before gating, ms */
+    pthread_mutex_t     clk_mutex;
+    pthread_t           clk_tid;
+    int                 clk_chid;
+    int                 clk_coid;
+    timer_t             clk_timer;
+    unsigned            clk_restart;    /* reference held for a pending repeated START */
 
 	unsigned			re_start;
     int                 intr;
@@ -58,7 +81,23 @@ typedef struct _omap_dev {
 	unsigned int		speed;
 	volatile int		intexpected;
 	volatile uint32_t	status;
+	volatile int		bfexpected;
+	omap_i2c_seg_t		*segs;			/* combined transaction, run by the ISR */
+	int					nsegs;
+	volatile int		seg;			/* next segment to start */
+
+	/* EDMA: transfers of at least dma_min bytes go through a bounce
+	 * buffer, the ISR only sees completion and errors */
+	uintptr_t			edma_vbase;
+	int					edma_tx_chid;
+	int					edma_rx_chid;
+	unsigned			dma_min;
+	uint8_t				*dma_buf;
+	uint32_t			dma_pbuf;
+	volatile int		dma_active;
     struct sigevent     intrevent;
+    struct sigevent     bfevent;
+    unsigned            bb_timeout;     /* bus free timeout, ms */
     int                 intr_priority;
 
     unsigned            own_addr;
@@ -90,6 +129,7 @@ typedef struct _omap_dev {
         unsigned        sysc;
         unsigned        we;
     } state;
+    omap_i2c_stats_t    stats;
 } omap_dev_t;
 
 #define OMAP_OPT_VERBOSE        0x00000002
@@ -104,8 +144,20 @@ typedef struct _omap_dev {
 #define OMAP_I2C_IE_XDR			(1<<14)
 #define OMAP_I2C_STAT_RDR		(1<<13)
 #define OMAP_I2C_STAT_XDR		(1<<14)
+#define OMAP_I2C_IE_BF			(1<<8)
+#define OMAP_I2C_STAT_BF		(1<<8)
+#define OMAP_I2C_SYSTEST_ST_EN	(1<<15)
+#define OMAP_I2C_SYSTEST_TMODE_IO	(3<<12)
+#define OMAP_I2C_SYSTEST_SCL_I_FUNC	(1<<8)
+#define OMAP_I2C_SYSTEST_SDA_I_FUNC	(1<<6)
+#define OMAP_I2C_SYSTEST_SCL_O	(1<<2)
+#define OMAP_I2C_SYSTEST_SDA_O	(1<<0)
 #define OMAP_I2C_BUF_RXFIF_CLR	(1<<14)
 #define OMAP_I2C_BUF_TXFIF_CLR	(1<<6)
+#define OMAP_I2C_BUF_RDMA_EN	(1<<15)
+#define OMAP_I2C_BUF_XDMA_EN	(1<<7)
+#define OMAP_I2C_BUF_RTRSH		(0x3f<<8)
+#define OMAP_I2C_BUF_XTRSH		(0x3f)
 #define OMAP_I2C_BUFSTAT_TXSTAT	(0x3f)
 #define OMAP_I2C_BUFSTAT_RXSTAT	((0x3f)<<8)
 #define OMAP_I2C_IE_MASK		(OMAP_I2C_IE_AL |OMAP_I2C_IE_NACK |OMAP_I2C_IE_ARDY \
@@ -114,6 +166,14 @@ typedef struct _omap_dev {
 #define OMAP_I2C_WE_ALL         0x6F6F
 #define OMAP_I2C_CON_XSA        (1<<8)  //1: 10bit, 0:7bit
 #define OMAP_I2C_EVENT          1
+#define OMAP_I2C_BF_EVENT       2
+#define OMAP_I2C_BB_SPIN        200     /* STAT reads before waiting for BF */
+#define OMAP_I2C_BB_TIMEOUT     100     /* default bus free timeout, ms */
+#define OMAP_I2C_CLK_IDLE       10      /* default clock gating idle time, ms */
+#define OMAP_I2C_EDMA_BASE      0x49000000  /* EDMA0 channel controller */
+#define OMAP_I2C_EDMA_RELOAD    64      /* Offset of the reload PaRAM sets */
+#define OMAP_I2C_DMA_SIZE       4096    /* Largest transfer done by EDMA */
+#define OMAP_I2C_DMA_MIN        32      /* default smallest transfer done by EDMA */
 
 #ifndef _SLOGC_I2C
 #define _SLOGC_I2C              23
@@ -145,7 +205,19 @@ int omap_i2c_reset(omap_dev_t *dev);
 
 void omap_clock_enable(omap_dev_t* dev);
 void omap_clock_disable(omap_dev_t* dev);
+void omap_clock_restart(omap_dev_t* dev);
 int omap_clock_toggle_init(omap_dev_t* dev);
+void omap_clock_toggle_fini(omap_dev_t* dev);
+void omap_setup_done(omap_dev_t *dev, uint64_t start, unsigned len);
+void omap_seg_start(omap_dev_t *dev);
+int omap_xfer(omap_dev_t *dev, omap_i2c_xfer_t *xfer, int msglen);
+void omap_intr_disable(omap_dev_t *dev, uint16_t mask);
+
+int omap_dma_init(omap_dev_t *dev);
+void omap_dma_fini(omap_dev_t *dev);
+int omap_dma_use(omap_dev_t *dev, unsigned len, int rx);
+void omap_dma_start(omap_dev_t *dev, void *buf, unsigned len, int rx);
+uint32_t omap_dma_finish(omap_dev_t *dev, void *buf, unsigned len, int rx, uint32_t status);
 int omap_i2c_bus_recover(omap_dev_t *dev);
 int omap_reg_map_init(omap_dev_t* dev);
 
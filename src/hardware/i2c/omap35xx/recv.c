@@ -25,11 +25,14 @@ i2c_status_t
 omap_recv(void *hdl, void *buf, unsigned int len, unsigned int stop)
 {
     omap_dev_t      *dev = hdl;
+    uint64_t        start;
     i2c_status_t    ret;
 
     if (len <= 0) 
         return I2C_STATUS_DONE;
 
+    ClockTime(CLOCK_MONOTONIC, NULL, &start);
+
     if (-1 == omap_wait_bus_not_busy(dev, stop))
         return I2C_STATUS_BUSY;
 
@@ -54,6 +57,9 @@ omap_recv(void *hdl, void *buf, unsigned int len, unsigned int stop)
 	/* Clear the FIFO Buffers */
 	out16(dev->regbase + OMAP_I2C_BUF, in16(dev->regbase + OMAP_I2C_BUF)| OMAP_I2C_BUF_RXFIF_CLR | OMAP_I2C_BUF_TXFIF_CLR);
 
+    if (omap_dma_use(dev, len, 1))
+        omap_dma_start(dev, buf, len, 1);
+
     /* set start condition */
     out16(dev->regbase + OMAP_I2C_CON,
             OMAP_I2C_CON_EN  |
@@ -61,9 +67,13 @@ omap_recv(void *hdl, void *buf, unsigned int len, unsigned int stop)
             OMAP_I2C_CON_STT |
             (stop? OMAP_I2C_CON_STP : 0) |
             (in16(dev->regbase + OMAP_I2C_CON)&OMAP_I2C_CON_XA));
+    omap_setup_done(dev, start, len);
 
     ret=  omap_wait_status(dev);
+    if (dev->dma_active)
+        ret = omap_dma_finish(dev, buf, len, 1, ret);
 
+	omap_clock_restart(dev);
 	omap_clock_disable(dev);
 
     return ret;
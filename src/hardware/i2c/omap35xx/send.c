@@ -25,12 +25,15 @@ i2c_status_t
 omap_send(void *hdl, void *buf, unsigned int len, unsigned int stop)
 {
     omap_dev_t      *dev = hdl;
+    uint64_t        start;
     i2c_status_t    ret = I2C_STATUS_ERROR;
     int num_bytes;
 
     if (len <= 0)
         return I2C_STATUS_DONE;
 
+    ClockTime(CLOCK_MONOTONIC, NULL, &start);
+
     if (-1 == omap_wait_bus_not_busy(dev, stop))
         return I2C_STATUS_BUSY;
 
@@ -55,16 +58,20 @@ omap_send(void *hdl, void *buf, unsigned int len, unsigned int stop)
 	/* Clear the FIFO Buffers */
 	out16(dev->regbase + OMAP_I2C_BUF, in16(dev->regbase + OMAP_I2C_BUF)| OMAP_I2C_BUF_RXFIF_CLR | OMAP_I2C_BUF_TXFIF_CLR);
 
-    /* pre-fill the fifo with outgoing data */
-    if (dev->xlen > dev->fifo_size)
-      num_bytes = dev->fifo_size;
-    else
-      num_bytes = dev->xlen;
-    while (num_bytes)
-    {
-      out8(dev->regbase + OMAP_I2C_DATA, *dev->buf++);
-      dev->xlen--;
-      num_bytes--;
+    if (omap_dma_use(dev, len, 0)) {
+        omap_dma_start(dev, buf, len, 0);
+    } else {
+        /* pre-fill the fifo with outgoing data */
+        if (dev->xlen > dev->fifo_size)
+            num_bytes = dev->fifo_size;
+        else
+            num_bytes = dev->xlen;
+        while (num_bytes)
+        {
+            out8(dev->regbase + OMAP_I2C_DATA, *dev->buf++);
+            dev->xlen--;
+            num_bytes--;
+        }
     }
 
     /* set start condition */
@@ -75,8 +82,12 @@ omap_send(void *hdl, void *buf, unsigned int len, unsigned int stop)
             OMAP_I2C_CON_STT |
             (stop? OMAP_I2C_CON_STP : 0)|
             (in16(dev->regbase + OMAP_I2C_CON)&OMAP_I2C_CON_XA));
+	omap_setup_done(dev, start, len);
 
 	ret=  omap_wait_status(dev);
+	if (dev->dma_active)
+		ret = omap_dma_finish(dev, buf, len, 0, ret);
+	omap_clock_restart(dev);
 	omap_clock_disable(dev);
     return ret;
 }
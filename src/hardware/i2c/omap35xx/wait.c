@@ -20,6 +20,8 @@
  */
 
 
+#include <sys/slog.h>
+#include <sys/slogcodes.h>
 #include "proto.h"
 
 #define OMAP_I2C_STAT_MASK \
@@ -36,10 +38,66 @@
              OMAP_I2C_STAT_AL)
 
 
+void
+omap_intr_disable(omap_dev_t *dev, uint16_t mask)
+{
+#ifdef OMAP_I2C_IE_CLR
+	out16(dev->regbase + OMAP_I2C_IE_CLR, mask);
+#else
+	out16(dev->regbase + OMAP_I2C_IE, in16(dev->regbase + OMAP_I2C_IE) & ~mask);
+#endif
+}
+
+/*
+ * Block on the bus free interrupt until BB clears or the timeout expires.
+ * A BF pulse is only a hint, BB is always checked again.
+ */
+static int
+omap_wait_bus_free(omap_dev_t *dev)
+{
+	struct _pulse	pulse;
+	uint64_t		now, deadline, ntime;
+	int				ret = 0;
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &now);
+	deadline = now + (uint64_t)dev->bb_timeout * 1000000;
+
+	while (in16(dev->regbase + OMAP_I2C_STAT) & OMAP_I2C_STAT_BB) {
+		dev->bfexpected = 1;
+		out16(dev->regbase + OMAP_I2C_IE, in16(dev->regbase + OMAP_I2C_IE) | OMAP_I2C_IE_BF);
+
+		/* the STOP may have gone by before the interrupt was enabled */
+		if (!(in16(dev->regbase + OMAP_I2C_STAT) & OMAP_I2C_STAT_BB)) {
+			break;
+		}
+
+		ClockTime(CLOCK_MONOTONIC, NULL, &now);
+		if (now >= deadline) {
+			ret = -1;
+			break;
+		}
+		ntime = deadline - now;
+		TimerTimeout(CLOCK_MONOTONIC, _NTO_TIMEOUT_RECEIVE, NULL, &ntime, NULL);
+		if (MsgReceivePulse(dev->chid, &pulse, sizeof(pulse), NULL) == -1) {
+			if (errno != ETIMEDOUT || (in16(dev->regbase + OMAP_I2C_STAT) & OMAP_I2C_STAT_BB)) {
+				ret = -1;
+			}
+			break;
+		}
+	}
+
+	dev->bfexpected = 0;
+	omap_intr_disable(dev, OMAP_I2C_IE_BF);
+	out16(dev->regbase + OMAP_I2C_STAT, OMAP_I2C_STAT_BF);
+
+	return ret;
+}
+
 int
 omap_wait_bus_not_busy(omap_dev_t *dev, unsigned int stop)
 {
-    unsigned        tries = 1000000;
+    unsigned        tries = OMAP_I2C_BB_SPIN;
+	uint64_t		start, end;
 
 	if(dev->re_start) {
 		if (stop){
@@ -48,16 +106,34 @@ omap_wait_bus_not_busy(omap_dev_t *dev, unsigned int stop)
 		return 0;
 	}else {
 		omap_clock_enable(dev);
-		while (in16(dev->regbase + OMAP_I2C_STAT) & OMAP_I2C_STAT_BB){
-			if (tries-- == 0){
-				/* reset the controller to see if it's able to recover*/
+		dev->stats.bb_checks++;
+
+		/* the bus is normally idle, spin briefly before blocking */
+		while ((in16(dev->regbase + OMAP_I2C_STAT) & OMAP_I2C_STAT_BB) && --tries)
+			;
+
+		if (tries == 0) {
+			dev->stats.bb_waits++;
+			ClockTime(CLOCK_MONOTONIC, NULL, &start);
+			if (omap_wait_bus_free(dev) == -1) {
+				dev->stats.bb_timeouts++;
+				if (dev->options & OMAP_OPT_VERBOSE) {
+					slogf(_SLOGC_I2C, _SLOG_WARNING, "i2c-omap35xx: bus busy for %d ms, recovering",
+						dev->bb_timeout);
+				}
+				/* a slave may be holding SDA, clock it out before resetting the controller */
+				omap_i2c_bus_recover(dev);
 				if (omap_i2c_reset(dev) == -1) {
 					goto fail; // CAN NOT recover form bus busy!
-				}else{
-					break;
 				}
 			}
+			ClockTime(CLOCK_MONOTONIC, NULL, &end);
+			dev->stats.bb_wait_ns += end - start;
+			if (end - start > dev->stats.bb_wait_max_ns) {
+				dev->stats.bb_wait_max_ns = end - start;
+			}
 		}
+
 		/* The I2C_STAT register should be 0, otherwise reset the I2C interface */
 		if (in16(dev->regbase + OMAP_I2C_STAT)) {
 			if (omap_i2c_reset(dev) == -1) {
@@ -76,17 +152,37 @@ fail:
 	return -1;
 }
 
+/*
+ * Time from the transfer request until the START condition was issued,
+ * including ungating the clock and waiting for the bus.
+ */
+void
+omap_setup_done(omap_dev_t *dev, uint64_t start, unsigned len)
+{
+	uint64_t		now;
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &now);
+	dev->stats.xfers++;
+	dev->stats.bytes += len;
+	dev->stats.setup_ns += now - start;
+	if (now - start > dev->stats.setup_max_ns) {
+		dev->stats.setup_max_ns = now - start;
+	}
+}
+
 const struct sigevent *i2c_intr(void *area, int id)
 {
 	omap_dev_t *dev = area;
 	uint16_t	stat; 
 	uint16_t	transmit_stat = (OMAP_I2C_STAT_XRDY | OMAP_I2C_STAT_XDR);
 	uint16_t	receive_stat = (OMAP_I2C_STAT_RRDY | OMAP_I2C_STAT_RDR);
+	int			next_seg = 0;
 	
 	// Shouldn't be here if clocks are disabled
 	if(dev->clkctrl_disabled){
 	    return NULL;
 	}
+	dev->stats.intr++;
 
 	if (dev->options & OMAP_OPT_ROVR_XUDF_OK) {
 		transmit_stat |= OMAP_I2C_STAT_XUDF;
@@ -115,11 +211,17 @@ const struct sigevent *i2c_intr(void *area, int id)
 			}
 		}
 		if (stat & OMAP_I2C_STAT_ARDY) {
-			dev->status |= I2C_STATUS_DONE;
+			// continue a combined transaction with a repeated START
+			if (dev->seg < dev->nsegs &&
+				!(dev->status & (I2C_STATUS_NACK | I2C_STATUS_ARBL | I2C_STATUS_ERROR))) {
+				next_seg = 1;
+			} else {
+				dev->status |= I2C_STATUS_DONE;
+			}
 		}
 
-		// check receive interrupt
-		if (stat & receive_stat) {
+		// check receive interrupt, the EDMA does the data phase on its own
+		if ((stat & receive_stat) && !dev->dma_active) {
 			int num_bytes = 1;
 			if (dev->fifo_size) {
 				if (stat & OMAP_I2C_STAT_RRDY)
@@ -139,7 +241,7 @@ const struct sigevent *i2c_intr(void *area, int id)
 		}
 
 		// check transmit interrupt
-		if (stat & transmit_stat) {
+		if ((stat & transmit_stat) && !dev->dma_active) {
 			int num_bytes = 1;
 			if (dev->fifo_size) {
 				if (stat & OMAP_I2C_STAT_XRDY)
@@ -162,6 +264,18 @@ const struct sigevent *i2c_intr(void *area, int id)
 	//clear the status
 	out16(dev->regbase + OMAP_I2C_STAT, stat);
 
+	if (next_seg) {
+		omap_seg_start(dev);
+		return NULL;
+	}
+
+	// bus went idle, wake up omap_wait_bus_free()
+	if (dev->bfexpected && !(stat & OMAP_I2C_STAT_BB)) {
+		dev->bfexpected = 0;
+		omap_intr_disable(dev, OMAP_I2C_IE_BF);
+		return &dev->bfevent;
+	}
+
 	// check transaction done
 	if ((dev->status & I2C_STATUS_DONE) && dev->intexpected) {
 		dev->intexpected = 0;
@@ -189,6 +303,8 @@ omap_wait_status(omap_dev_t *dev)
 			// this second reset is needed for J5
 			omap_i2c_reset(dev);
 #endif
+			// the transaction is gone, no repeated START can follow
+			dev->re_start = 0;
 			return (I2C_STATUS_DONE | I2C_STATUS_ERROR);
 		}
 		switch (pulse.code) {
@@ -0,0 +1,126 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2014, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#include "proto.h"
+
+/*
+ * Start the next segment of a combined transaction. Called by the thread
+ * for the first segment and by the ISR on ARDY for the following ones, so
+ * only register accesses here.
+ */
+void
+omap_seg_start(omap_dev_t *dev)
+{
+	omap_i2c_seg_t	*seg = &dev->segs[dev->seg++];
+	int				last = (dev->seg == dev->nsegs);
+
+	dev->xlen = seg->len;
+
+	out16(dev->regbase + OMAP_I2C_CNT, seg->len);
+	out16(dev->regbase + OMAP_I2C_BUF, in16(dev->regbase + OMAP_I2C_BUF) | OMAP_I2C_BUF_RXFIF_CLR | OMAP_I2C_BUF_TXFIF_CLR);
+	out16(dev->regbase + OMAP_I2C_CON,
+			OMAP_I2C_CON_EN  |
+			OMAP_I2C_CON_MST |
+			((seg->flags & OMAP_I2C_SEG_READ) ? 0 : OMAP_I2C_CON_TRX) |
+			OMAP_I2C_CON_STT |
+			(last ? OMAP_I2C_CON_STP : 0) |
+			(in16(dev->regbase + OMAP_I2C_CON) & OMAP_I2C_CON_XA));
+}
+
+/*
+ * DCMD_I2C_OMAP_XFER: run all segments with one bus check, one clock
+ * reference and one completion.
+ */
+int
+omap_xfer(omap_dev_t *dev, omap_i2c_xfer_t *xfer, int msglen)
+{
+	omap_i2c_seg_t	*segs = (omap_i2c_seg_t *)(xfer + 1);
+	uint64_t		start;
+	int				hdrlen, datalen = 0;
+	unsigned		i;
+
+	if (msglen < sizeof(*xfer) || xfer->nsegs == 0 || xfer->nsegs > OMAP_I2C_XFER_MAXSEGS) {
+		return EINVAL;
+	}
+	if (xfer->slave.fmt != I2C_ADDRFMT_7BIT && xfer->slave.fmt != I2C_ADDRFMT_10BIT) {
+		return EINVAL;
+	}
+	hdrlen = sizeof(*xfer) + xfer->nsegs * sizeof(*segs);
+	if (msglen < hdrlen) {
+		return EINVAL;
+	}
+	for (i = 0; i < xfer->nsegs; i++) {
+		if (segs[i].len == 0 || segs[i].len > 0xffff) {
+			return EINVAL;
+		}
+		datalen += segs[i].len;
+	}
+	if (msglen < hdrlen + datalen) {
+		return EINVAL;
+	}
+
+	ClockTime(CLOCK_MONOTONIC, NULL, &start);
+	xfer->segs_done = 0;
+
+	/* a pending repeated START from omap_send() is closed by this transaction */
+	if (-1 == omap_wait_bus_not_busy(dev, 1)) {
+		xfer->status = I2C_STATUS_BUSY;
+		return EOK;
+	}
+
+	omap_clock_enable(dev);
+
+	dev->buf = (uint8_t *)xfer + hdrlen;
+	dev->segs = segs;
+	dev->nsegs = xfer->nsegs;
+	dev->seg = 0;
+	dev->status = 0;
+	dev->intexpected = 1;
+
+	if (xfer->slave.fmt == I2C_ADDRFMT_7BIT)
+		out16(dev->regbase + OMAP_I2C_CON, in16(dev->regbase + OMAP_I2C_CON) & (~OMAP_I2C_CON_XSA));
+	else
+		out16(dev->regbase + OMAP_I2C_CON, in16(dev->regbase + OMAP_I2C_CON) | OMAP_I2C_CON_XSA);
+	out16(dev->regbase + OMAP_I2C_SA, xfer->slave.addr);
+
+	omap_seg_start(dev);
+	omap_setup_done(dev, start, datalen);
+
+	xfer->status = omap_wait_status(dev);
+
+	/* the segment in flight when the transaction ended did not complete */
+	xfer->segs_done = dev->seg - 1;
+	if (!(xfer->status & (I2C_STATUS_NACK | I2C_STATUS_ARBL | I2C_STATUS_ERROR))) {
+		xfer->segs_done = dev->seg;
+	}
+	dev->nsegs = 0;
+	dev->segs = NULL;
+
+	omap_clock_restart(dev);
+	omap_clock_disable(dev);
+
+	return EOK;
+}
+
+#if defined(__QNXNTO__) && defined(__USESRCVERSION)
+#include <sys/srcversion.h>
+__SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/i2c/omap35xx/xfer.c $ $Rev: 765543 $")
+#endif
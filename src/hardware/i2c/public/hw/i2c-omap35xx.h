@@ -0,0 +1,98 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2014, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#ifndef __I2C_OMAP35XX_H_INCLUDED
+#define __I2C_OMAP35XX_H_INCLUDED
+
+#include <stdint.h>
+#include <hw/i2c.h>
+
+/*
+ * Driver specific devctls of i2c-omap35xx. The command numbers start
+ * above the generic DCMD_I2C_* range.
+ */
+
+/**
+ * Bus statistics.
+ * flags - OMAP_I2C_STATS_CLR to reset the counters after reading them
+ */
+typedef struct _omap_i2c_stats {
+	uint32_t	flags;
+	uint32_t	reserved0;
+	uint64_t	bb_checks;		/* Bus busy checks before a transfer */
+	uint64_t	bb_waits;		/* Checks that had to wait for bus free */
+	uint64_t	bb_wait_ns;		/* Total time spent waiting for bus free */
+	uint64_t	bb_wait_max_ns;	/* Longest wait for bus free */
+	uint64_t	bb_timeouts;	/* Waits that timed out */
+	uint64_t	recoveries;		/* Bus recoveries (SCL pulses and STOP) */
+	uint64_t	recover_fail;	/* Recoveries that left SDA low */
+	uint64_t	clk_on;			/* Module clock ungated */
+	uint64_t	clk_off;		/* Module clock gated */
+	uint64_t	ctx_restores;	/* Register context lost while gated and restored */
+	uint64_t	xfers;			/* Transfers started */
+	uint64_t	setup_ns;		/* Total time from request to START */
+	uint64_t	setup_max_ns;	/* Longest time from request to START */
+	uint64_t	intr;			/* Controller interrupts */
+	uint64_t	bytes;			/* Bytes transferred */
+	uint64_t	dma_xfers;		/* Transfers done by EDMA */
+	uint32_t	reserved[4];
+} omap_i2c_stats_t;
+
+#define OMAP_I2C_STATS_CLR			0x01
+
+#define DCMD_I2C_OMAP_STATS			__DIOTF(_DCMD_I2C, 0x80, omap_i2c_stats_t)
+
+/**
+ * Combined transaction. The segments are run back to back with a repeated
+ * START between them and a single STOP after the last one, in one call.
+ * The message is laid out as:
+ *   omap_i2c_xfer_t
+ *   omap_i2c_seg_t[nsegs]
+ *   data of all segments, in segment order
+ * Write data is taken from the data area, read data is returned in place.
+ * status   - (out) I2C_STATUS_* of the transaction
+ * segs_done - (out) segments completed without error
+ */
+typedef struct _omap_i2c_seg {
+	uint32_t	flags;			/* OMAP_I2C_SEG_* */
+	uint32_t	len;			/* Bytes to write or read, 1..65535 */
+} omap_i2c_seg_t;
+
+#define OMAP_I2C_SEG_READ			0x01
+
+typedef struct _omap_i2c_xfer {
+	i2c_addr_t	slave;
+	uint32_t	nsegs;
+	uint32_t	status;
+	uint32_t	segs_done;
+	uint32_t	reserved;
+} omap_i2c_xfer_t;
+
+#define OMAP_I2C_XFER_MAXSEGS		32
+
+#define DCMD_I2C_OMAP_XFER			__DIOTF(_DCMD_I2C, 0x81, omap_i2c_xfer_t)
+
+#endif
+
+#if defined(__QNXNTO__) && defined(__USESRCVERSION)
+#include <sys/srcversion.h>
+__SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/i2c/public/hw/i2c-omap35xx.h $ $Rev: 765543 $")
+#endif
@@ -22,6 +22,10 @@
 
 #include "omap3spi.h"
 
+#define OPT_TCINTEN			(1 << 20)
+#define OPT_TCC(x)			((x) << 12)
+#define OMAP3_EDMA_NULL		0xFFFF
+
 static inline void edma_setbit(uintptr_t base, int reg, int bit)
 {
 	if (bit > 31)
@@ -45,65 +49,274 @@ void omap3_edma_disablespi(omap3_spi_t *omap3)
 	edma_setbit(edmabase,    DM6446_EDMA_EMCR, omap3->edma_tx_chid);
 }
 
-int omap3_setup_edma(omap3_spi_t *omap3, int device, spi_dma_paddr_t *paddr, int len )
+static inline edma_t *edma_param(omap3_spi_t *omap3, int set)
 {
-	uint32_t	acnt, bcnt, ccnt;
-	edma_t	*param;
+	return ((edma_t *)(omap3->edmavbase + DM6446_EDMA_PARAM_BASE + (0x20 * set)));
+}
 
-	acnt = omap3->dlen;
-	bcnt = (len / omap3->dlen) & 0x7FFF;		/* We use 32KB chunk */
-	ccnt = (len / omap3->dlen + 0x7FFF) >> 15;
+static inline uint32_t edma_link(int set)
+{
+	return (DM6446_EDMA_PARAM_BASE + (0x20 * set));
+}
 
-	if (bcnt == 0)
-		bcnt = 0x8000;
+/*
+ * Per-device PaRAM templates. Everything but the addresses, the counts,
+ * the link and the completion interrupt enable only depends on the
+ * device and its data length.
+ */
+static void omap3_edma_template(omap3_spi_t *omap3, int device)
+{
+	omap3_chan_t	*ch = &omap3->chan[device];
+	uint32_t		acnt = omap3->dlen;
+	edma_t			*param;
 
-	omap3_edma_disablespi(omap3);
+	if (ch->edma_dlen == acnt)
+		return;
 
-	/********************
-	 * Setup Tx channel *
-	 ********************/
-	param = (edma_t *)(omap3->edmavbase + DM6446_EDMA_PARAM_BASE + (0x20 * omap3->edma_tx_chid));
-
-	if (paddr->wpaddr)
-		param->src     = (uint32_t)paddr->wpaddr;
-	else
-		param->src     = (uint32_t)paddr->rpaddr;
-	param->opt         = (omap3->edma_tx_chid << 12);	/* ACNT only */
-	param->abcnt       = (bcnt << 16) | acnt;
-	param->dst         = omap3->pbase+OMAP3_MCSPI_CH1_TX_BUFFER_OFFSET + (0x14 * device) ;
+	param = &ch->txparam;
+	param->opt         = OPT_TCC(omap3->edma_tx_chid);	/* ACNT only */
+	param->src         = 0;
+	param->abcnt       = acnt;
+	param->dst         = omap3->pbase + OMAP3_MCSPI_CH1_TX_BUFFER_OFFSET + (0x14 * device);
 	param->srcdstbidx  = (0 << 16) | acnt;
-	param->linkbcntrld = 0xFFFF | (0x8000 << 16);
-	param->srcdstcidx  = (0 << 16) | acnt;
-	param->ccnt        = ccnt;
-
-	/********************
-	 * Setup Rx channel *
-	 ********************/
-	param = (edma_t *)(omap3->edmavbase + DM6446_EDMA_PARAM_BASE + (0x20 * omap3->edma_rx_chid));
-
-	if (paddr->rpaddr) {
-		param->dst        = (uint32_t)paddr->rpaddr;
-		param->srcdstbidx = (acnt << 16) | 0;
-		param->srcdstcidx = (acnt << 16) | 0;
+	param->linkbcntrld = OMAP3_EDMA_NULL;
+	param->srcdstcidx  = 0;
+	param->ccnt        = 1;
+
+	param = &ch->rxparam;
+	param->opt         = OPT_TCC(omap3->edma_rx_chid);	/* ACNT only */
+	param->src         = omap3->pbase + OMAP3_MCSPI_CH1_RX_BUFFER_OFFSET + (0x14 * device);
+	param->abcnt       = acnt;
+	param->dst         = 0;
+	param->srcdstbidx  = (acnt << 16) | 0;
+	param->linkbcntrld = OMAP3_EDMA_NULL;
+	param->srcdstcidx  = 0;
+	param->ccnt        = 1;
+
+	ch->edma_dlen = acnt;
+	if (omap3->edma_tmpl == device)
+		omap3->edma_tmpl = -1;
+}
+
+static void edma_copy(edma_t *param, edma_t *tmpl)
+{
+	param->opt         = tmpl->opt;
+	param->src         = tmpl->src;
+	param->abcnt       = tmpl->abcnt;
+	param->dst         = tmpl->dst;
+	param->srcdstbidx  = tmpl->srcdstbidx;
+	param->linkbcntrld = tmpl->linkbcntrld;
+	param->srcdstcidx  = tmpl->srcdstcidx;
+	param->ccnt        = tmpl->ccnt;
+}
+
+/*
+ * Segment seg raises a completion interrupt if it is the last one, or,
+ * in double buffered mode, if its completion frees the reload set that
+ * a segment still to be queued needs.
+ */
+static int omap3_edma_irq(omap3_spi_t *omap3, int seg)
+{
+	omap3_edma_xfer_t	*edx = &omap3->edx;
+
+	return (seg == edx->nseg - 1 || seg + OMAP3_EDMA_NSETS < edx->nseg);
+}
+
+/*
+ * PaRAM set of a segment: the first one runs in the channel set, the
+ * others alternate between the two reload sets.
+ */
+static inline int edma_set(int chid, int seg)
+{
+	if (seg == 0)
+		return chid;
+
+	return (chid + ((seg - 1) & 1 ? 2 : 1) * OMAP3_EDMA_RELOAD);
+}
+
+/*
+ * Queue one segment. The first goes into the channel sets, which the
+ * previous exchange left as null sets, the others into the reload sets
+ * where only the addresses, the counts, the link and OPT are patched.
+ * A segment is queued with a null link, the set of the previous segment
+ * only links to it once it is complete. A channel that catches up with
+ * the queue stops on the null set instead of running a reload set again
+ * with the addresses of an old segment.
+ */
+static void omap3_edma_queue(omap3_spi_t *omap3, int seg)
+{
+	omap3_edma_xfer_t	*edx = &omap3->edx;
+	omap3_chan_t		*ch = &omap3->chan[omap3->edma_tmpl];
+	uint32_t			acnt = omap3->dlen;
+	uint32_t			bcnt, off;
+	edma_t				*tx, *rx;
+
+	off = seg * OMAP3_EDMA_SEG;
+	bcnt = min(edx->elems - off, OMAP3_EDMA_SEG);
+	off *= acnt;
+
+	tx = edma_param(omap3, edma_set(omap3->edma_tx_chid, seg));
+	rx = edma_param(omap3, edma_set(omap3->edma_rx_chid, seg));
+	if (seg == 0) {
+		edma_copy(tx, &ch->txparam);
+		edma_copy(rx, &ch->rxparam);
 	}
-	else {
-		param->dst        = omap3->pdmabuf;
-		param->srcdstbidx = (0 << 16) | 0;
-		param->srcdstcidx = (0 << 16) | 0;
+
+	tx->linkbcntrld = OMAP3_EDMA_NULL;
+	rx->linkbcntrld = OMAP3_EDMA_NULL;
+	tx->src        = edx->tx + off;
+	tx->abcnt      = (bcnt << 16) | acnt;
+	rx->dst        = edx->rx + (edx->rxinc ? off : 0);
+	rx->srcdstbidx = edx->rxinc ? (acnt << 16) : 0;
+	rx->abcnt      = (bcnt << 16) | acnt;
+	rx->opt        = ch->rxparam.opt | (omap3_edma_irq(omap3, seg) ? OPT_TCINTEN : 0);
+
+	if (seg > 0) {
+		edma_param(omap3, edma_set(omap3->edma_tx_chid, seg - 1))->linkbcntrld =
+			edma_link(edma_set(omap3->edma_tx_chid, seg));
+		edma_param(omap3, edma_set(omap3->edma_rx_chid, seg - 1))->linkbcntrld =
+			edma_link(edma_set(omap3->edma_rx_chid, seg));
+	}
+
+	ch->stats.dma_segs++;
+}
+
+/*
+ * After a refill: a channel that already loaded the set of the previous
+ * segment runs with its null link, point it to the refilled set. If it
+ * has also finished that segment it stopped on the null set, the refill
+ * came too late and -1 is returned.
+ */
+static int omap3_edma_relink(omap3_spi_t *omap3, int chid, int seg)
+{
+	edma_t		*param = edma_param(omap3, chid);
+
+	if ((param->linkbcntrld & 0xFFFF) != OMAP3_EDMA_NULL)
+		return 0;
+
+	param->linkbcntrld = edma_link(edma_set(chid, seg));
+
+	/* A null set has no count, it may have been loaded in between */
+	if ((param->abcnt & 0xFFFF) == 0)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Program an exchange of len bytes and enable the EDMA events. Up to
+ * OMAP3_EDMA_NSETS segments are queued, the others are queued by
+ * omap3_edma_next() as the exchange progresses. Without edmadbuf the
+ * caller has already rejected exchanges that do not fit in the PaRAM sets.
+ * Returns the number of bytes that will be transferred.
+ */
+int omap3_edma_start(omap3_spi_t *omap3, int device, spi_dma_paddr_t *paddr, int len)
+{
+	omap3_edma_xfer_t	*edx = &omap3->edx;
+	omap3_chan_t		*ch = &omap3->chan[device];
+	int					i;
+
+	omap3_edma_template(omap3, device);
+
+	/* The reload sets keep the fixed part of the device that used them last */
+	if (omap3->edma_tmpl != device) {
+		for (i = 1; i < OMAP3_EDMA_NSETS; i++) {
+			edma_copy(edma_param(omap3, omap3->edma_tx_chid + i * OMAP3_EDMA_RELOAD), &ch->txparam);
+			edma_copy(edma_param(omap3, omap3->edma_rx_chid + i * OMAP3_EDMA_RELOAD), &ch->rxparam);
+		}
+		omap3->edma_tmpl = device;
 	}
-	param->src            = omap3->pbase+OMAP3_MCSPI_CH1_RX_BUFFER_OFFSET + (0x14 * device) ;
-	param->abcnt          = (bcnt << 16) | acnt;
-	param->linkbcntrld    = 0xFFFF | (0x8000 << 16);
-	param->ccnt           = ccnt;
-	param->opt            = (omap3->edma_rx_chid << 12) | (1 << 20);	/* ACNT only, interrupt enable */
+
+	edx->tx    = paddr->wpaddr ? (uint32_t)paddr->wpaddr : (uint32_t)paddr->rpaddr;
+	edx->rx    = paddr->rpaddr ? (uint32_t)paddr->rpaddr : omap3->pdmabuf;
+	edx->rxinc = paddr->rpaddr != 0;
+	edx->elems = len / omap3->dlen;
+	edx->nseg  = (edx->elems + OMAP3_EDMA_SEG - 1) / OMAP3_EDMA_SEG;
+
+	for (i = 0; i < edx->nseg && i < OMAP3_EDMA_NSETS; i++)
+		omap3_edma_queue(omap3, i);
+
+	for (edx->irq = 0; !omap3_edma_irq(omap3, edx->irq); edx->irq++)
+		;
+
+	ch->stats.dma_xfers++;
 
 	/* Enable EDMA event */
 	edma_setbit(omap3->edmavbase, DM6446_EDMA_REGION0 + DM6446_EDMA_EESR, omap3->edma_rx_chid);
 	edma_setbit(omap3->edmavbase, DM6446_EDMA_REGION0 + DM6446_EDMA_EESR, omap3->edma_tx_chid);
 
-	return 0;
+	return (edx->elems * omap3->dlen);
+}
+
+/*
+ * Called for each completion interrupt. The reload set the completed
+ * segment was loaded from is free again, queue the segment that goes
+ * there. Returns 0 once the last segment has completed, -1 if the
+ * channels ran out of queued segments before the refill.
+ */
+int omap3_edma_next(omap3_spi_t *omap3)
+{
+	omap3_edma_xfer_t	*edx = &omap3->edx;
+	int					seg = edx->irq + OMAP3_EDMA_NSETS;
+
+	if (edx->irq == edx->nseg - 1)
+		return 0;
+
+	omap3_edma_queue(omap3, seg);
+	omap3->chan[omap3->edma_tmpl].stats.dma_refills++;
+
+	if (omap3_edma_relink(omap3, omap3->edma_tx_chid, seg) == -1 ||
+		omap3_edma_relink(omap3, omap3->edma_rx_chid, seg) == -1)
+		return -1;
+
+	while (!omap3_edma_irq(omap3, ++edx->irq))
+		;
+
+	return 1;
+}
+
+/*
+ * Bytes exchanged so far, from the position of the receive channel, or
+ * of the transmit channel when receiving into the dummy buffer. Only
+ * meaningful while the exchange is stopped before its end.
+ */
+int omap3_edma_progress(omap3_spi_t *omap3)
+{
+	omap3_edma_xfer_t	*edx = &omap3->edx;
+	uint32_t			start, pos;
+
+	if (edx->rxinc) {
+		start = edx->rx;
+		pos = edma_param(omap3, omap3->edma_rx_chid)->dst;
+	}
+	else {
+		start = edx->tx;
+		pos = edma_param(omap3, omap3->edma_tx_chid)->src;
+	}
+
+	/* A null set was linked in, or nothing was queued */
+	if (pos < start || pos > start + edx->elems * omap3->dlen)
+		return 0;
+
+	return ((pos - start) / omap3->dlen * omap3->dlen);
 }
 
+/*
+ * Check and acknowledge the completion of the receive channel.
+ */
+int omap3_edma_done(omap3_spi_t *omap3)
+{
+	uintptr_t	region0base = omap3->edmavbase + DM6446_EDMA_REGION0;
+	int			chid = omap3->edma_rx_chid;
+	uint32_t	ipr;
+
+	ipr = in32(region0base + (chid > 31 ? DM6446_EDMA_IPRH : DM6446_EDMA_IPR));
+	if (!(ipr & (1 << (chid & 31))))
+		return 0;
+
+	edma_setbit(region0base, DM6446_EDMA_ICR, chid);
+	return 1;
+}
 
 void
 omap3_edma_detach(omap3_spi_t *omap3)
@@ -175,6 +388,10 @@ int omap3_init_edma(omap3_spi_t *omap3)
 	
 	omap3_edma_disablespi(omap3);
 
+	/* Completion of the receive channel raises the region interrupt */
+	edma_setbit(omap3->edmavbase + DM6446_EDMA_REGION0, DM6446_EDMA_ICR,  omap3->edma_rx_chid);
+	edma_setbit(omap3->edmavbase + DM6446_EDMA_REGION0, DM6446_EDMA_IESR, omap3->edma_rx_chid);
+
 	return 0;
 }
 
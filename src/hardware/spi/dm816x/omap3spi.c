@@ -46,6 +46,7 @@ static char *omap3_opts[] = {
 	"pwr",			/* Power management */
 	"ocp",			/* Internal OCP Clock gating strategy */
 	"pin",			/* 0:use, 1:not-use PIN34: pin mode selection */
+	"edmadbuf",		/* 0:reject DMA exchanges over 3 segments, 1:queue segments while running */
 	NULL
 };
 
@@ -100,8 +101,6 @@ static spi_devinfo_t devlist[4] = {
 	}
 };
 
-static uint32_t devctrl[NUM_OF_SPI_DEVS];
-
 void set_port(unsigned port, unsigned mask, unsigned data) 
 {
 	uint32_t c;
@@ -236,6 +235,9 @@ static int omap3_options(omap3_spi_t *spi, char *optstring)
 				if(0!=val && 1!=val) fprintf(stderr, "spi-dm816x: spi->pin is out of range, use default(0)\n");
 				else spi->pin = val;
 				continue;
+			case 23:
+				spi->edma_dbuf = strtoul(value, 0, 0);
+				continue;
 		}
 error:
 		fprintf(stderr, "spi-dm816x: unknown option %s\n", c);
@@ -254,6 +256,7 @@ void *omap3_init(void *hdl, char *options)
 	int			i;
 	uint32_t	reg;
 	uint16_t	ext_div;
+	omap3_chan_t	*ch;
 
 	dev = calloc(1, sizeof(omap3_spi_t));
 	if (dev == NULL)
@@ -281,6 +284,9 @@ void *omap3_init(void *hdl, char *options)
 	dev->pwr = 2;
 	dev->ocp = 1;
 	dev->pin = 0;
+	dev->fifo_id = -1;
+	dev->edma_dbuf = 1;
+	dev->edma_tmpl = -1;
 
  	if (omap3_options(dev, options))
 		goto fail0;
@@ -312,10 +318,12 @@ void *omap3_init(void *hdl, char *options)
 	 * Calculate all device configuration here
 	 */
 	for (i = 0; i < dev->num_cs; i++) { //we have just one device defined in the driver till now....
-		devctrl[i] = omap3_cfg(dev, &devlist[i].cfg, &ext_div);
+		ch = &dev->chan[i];
+		ch->conf = omap3_cfg(dev, &devlist[i].cfg, &ext_div);
+		ch->ctrl = ext_div << OMAP3_MCSPI_CTRL_EXTCLK_OFF;
 		if (dev->force) {
 			/* if we need to set the default CSx level to other than defaul low, we need to kick it */
-			out32((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * i), devctrl[i] | SPI_COMM_TX_RX << 12);
+			out32((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * i), ch->conf | SPI_COMM_TX_RX << 12);
 			set_port(base + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * i, OMAP3_MCSPI_CHANNEL_ENABLE, OMAP3_MCSPI_CHANNEL_ENABLE);
 			//set register MCSPI_CH0CTRL: EXTCLK bit
 			set_port((base + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * i), OMAP3_MCSPI_CTRL_EXTCLK, (ext_div << OMAP3_MCSPI_CTRL_EXTCLK_OFF));
@@ -337,7 +345,12 @@ void *omap3_init(void *hdl, char *options)
 			set_port((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * i), OMAP3_MCSPI_CLKG, OMAP3_MCSPI_CLKG);
 			set_port((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * i), OMAP3_MCSPI_CLKD, (dev->clk_clkd) << 2);
 			set_port((base + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * i), OMAP3_MCSPI_CTRL_EXTCLK, (dev->clk_extclk) << 8);
+			ch->ctrl = (dev->clk_extclk) << 8;
 		}
+
+		/* the registers were written directly, the first transfer rewrites them */
+		ch->hw_conf = OMAP3_CHAN_UNKNOWN;
+		ch->hw_ctrl = OMAP3_CHAN_UNKNOWN;
 	
 		set_port(base + OMAP3_MCSPI_SYS_CONFIG, OMAP3_MCSPI_CONFIG_CLOCKACTIVITY, (dev->clk_activity) << 8);		
 		set_port(base + OMAP3_MCSPI_SYS_CONFIG, OMAP3_MCSPI_CONFIG_SIDLEMODE, (dev->pwr) << 3);		
@@ -380,13 +393,47 @@ fail0:
 	return NULL;
 }
 
-void omap3_setup(omap3_spi_t	*dev , uint32_t device)
+static void omap3_chan_conf(omap3_spi_t *dev, int id, uint32_t conf)
 {
-	uintptr_t	base = dev->vbase;
-	uint32_t	id;
+	omap3_chan_t	*ch = &dev->chan[id];
 
-	id = device & SPI_DEV_ID_MASK;
-	out32((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id), (SPI_COMM_TX_RX << 12) | devctrl[id]);
+	if (ch->hw_conf != conf) {
+		out32(dev->vbase + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, conf);
+		ch->hw_conf = conf;
+		ch->stats.conf_writes++;
+	}
+}
+
+static void omap3_chan_ctrl(omap3_spi_t *dev, int id, uint32_t ctrl)
+{
+	omap3_chan_t	*ch = &dev->chan[id];
+
+	if (ch->hw_ctrl != ctrl) {
+		out32(dev->vbase + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, ctrl);
+		ch->hw_ctrl = ctrl;
+		ch->stats.ctrl_writes++;
+	}
+}
+
+/*
+ * Bring the channel's CHxCONF to conf, CS not forced. Nothing is written
+ * when the previous transfer on this chip-select left it that way.
+ */
+static void omap3_setup(omap3_spi_t *dev, int id, uint32_t conf)
+{
+	omap3_chan_t	*ch = &dev->chan[id];
+	int				fid = dev->fifo_id;
+
+	/* Only one channel may have its FIFO enabled */
+	if (fid != -1 && fid != id)
+		omap3_chan_conf(dev, fid, dev->chan[fid].hw_conf & ~(OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW));
+	dev->fifo_id = (conf & (OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW)) ? id : -1;
+
+	ch->stats.xfers++;
+	if (ch->hw_conf == conf)
+		ch->stats.conf_skipped++;
+	else
+		omap3_chan_conf(dev, id, conf);
 }
 
 void omap3_dinit(void *hdl)
@@ -429,7 +476,7 @@ int omap3_setcfg(void *hdl, uint16_t device, spi_cfg_t *cfg)
 {
 	uint32_t	control;
 	omap3_spi_t	*dev = hdl;
-	uintptr_t	base = dev->vbase;
+	omap3_chan_t	*ch;
 	uint16_t	ext_div;
 
 	if (device >= dev->num_cs)
@@ -440,10 +487,13 @@ int omap3_setcfg(void *hdl, uint16_t device, spi_cfg_t *cfg)
 	if (control == 0)
 		return (EINVAL);
 
-	//set register MCSPI_CH0CTRL: EXTCLK bit
-	set_port((base + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * device), OMAP3_MCSPI_CTRL_EXTCLK, (ext_div << OMAP3_MCSPI_CTRL_EXTCLK_OFF));
-
-	devctrl[device] = control;
+	/* the registers are written by the next transfer on this chip-select */
+	ch = &dev->chan[device];
+	if (ch->conf != control || ch->ctrl != (ext_div << OMAP3_MCSPI_CTRL_EXTCLK_OFF)) {
+		ch->conf = control;
+		ch->ctrl = ext_div << OMAP3_MCSPI_CTRL_EXTCLK_OFF;
+		ch->stats.reconfigs++;
+	}
 
 	return (EOK);
 }
@@ -476,59 +526,24 @@ int omap3_devinfo(void *hdl, uint32_t device, spi_devinfo_t *info)
 	return (EOK);
 }
 
-void *omap3_xfer(void *hdl, uint32_t device, uint8_t *buf, int *len)
+/*
+ * Exchange one chunk, at most OMAP3_SPI_CHUNK words, with the channel
+ * configured and CS forced. dev->rlen has the bytes received, also
+ * when the chunk fails.
+ */
+static int omap3_xfer_chunk(omap3_spi_t *dev, int id, uint8_t *buf, int len)
 {
-	omap3_spi_t	*dev = hdl;
 	uintptr_t	base = dev->vbase;
-	uint32_t	id;
 	int 		i;
 	int 		timeout, expected;
 	uint32_t 	reg_value = 0;
+	int			rc = 0;
 
-	id = device & SPI_DEV_ID_MASK;
-	if (id >= dev->num_cs) {
-		*len = -1;
-		return buf;
-	}
-
-	dev->xlen = *len;
-	dev->dlen = ((devlist[id].cfg.mode & SPI_MODE_CHAR_LEN_MASK) + 7) >> 3;
-
-	/* 
-	 * Cannot set more than 64KB of data at one time 
-	 * due to the limitation of WCNT field in MCSPI_XFERLEVEL register
-	 */
-	if (dev->xlen >= (64 * 1024)) {
-		*len = -1;
-		return buf;
-	}
-
-	/* The transfer len must be integer multiple of the word width */
-	if (dev->xlen % dev->dlen) {
-		*len = -1;
-		return buf;
-	}
-
+	dev->xlen = len;
 	dev->rlen = 0;
 	dev->tlen = min(OMAP3_SPI_FIFOLEN * dev->dlen, dev->xlen);
 	dev->pbuf = buf;
 
-	// Estimate transfer time in us... The calculated dtime is only used for
-	// the timeout, so it doesn't have to be that accurate. At higher clock
-	// rates, a calcuated dtime of 0 would mess-up the timeout calculation, so
-	// round up to 1 us
-	dev->dtime = dev->dlen * 1000 * 1000 / devlist[id].cfg.clock_rate;
-	if (dev->dtime == 0)
-		dev->dtime = 1;
-
-	omap3_setup(dev, device);
-
-	/* force CS */
-	set_port((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id),OMAP3_MCSPI_FORCE_MODE_ONE, OMAP3_MCSPI_FORCE_MODE_ONE);
-
-	/* set FIFO */
-	set_port((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW, OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW);
-
 	/* 
 	 * Set FIFO transfer level
 	 * we rely on EOW interrupt to indicate the end of the tranfer
@@ -541,7 +556,7 @@ void *omap3_xfer(void *hdl, uint32_t device, uint8_t *buf, int *len)
 	out32(base + OMAP3_MCSPI_IRQ_STATUS_OFFSET, OMAP3_MCSPI_IRQ_RESET_CHANNEL(id));
 
 	/* Configue the SPI control register to enable the corresponding channel of the SPI */
- 	set_port(base + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, OMAP3_MCSPI_CHANNEL_ENABLE, OMAP3_MCSPI_CHANNEL_ENABLE);
+	omap3_chan_ctrl(dev, id, dev->chan[id].ctrl | OMAP3_MCSPI_CHANNEL_ENABLE);
 
 	/* Enable Interrupts */
 	out32(base + OMAP3_MCSPI_IRQ_ENABLE_OFFSET, INTR_TYPE_EOWKE | (INTR_TYPE_RX0_FULL << (id * OMAP3_INTERRUPT_BITS_PER_SPI_CHANNEL)));
@@ -566,11 +581,11 @@ void *omap3_xfer(void *hdl, uint32_t device, uint8_t *buf, int *len)
 	*/
 	if (omap3_wait(dev, dev->xlen * 10)) {
 		fprintf(stderr, "spi-dm816x: XFER Timeout!!!\n");
-		dev->rlen = -1;
+		rc = -1;
 	}
 
 	/* Read the last spi words when EOW interrupt is raised */
-	if (dev->rlen < dev->xlen && dev->rlen != -1) {
+	if (dev->rlen < dev->xlen && rc == 0) {
 		reg_value = in32(base + OMAP3_MCSPI_CH1_STATUS_OFFSET + (OMAP3_SPI_DEVICE_OFFSET * id));
 		timeout = 1000;
 		while( timeout-- && ((reg_value & OMAP3_MCSPI_CH_RX_REG_FULL) == 0) ) {
@@ -579,7 +594,7 @@ void *omap3_xfer(void *hdl, uint32_t device, uint8_t *buf, int *len)
 		}
 		
 		if(timeout <= 0) {
-			dev->rlen = -1;
+			rc = -1;
 		} else {
 			/* last words to read from buffer */
 			expected = dev->xlen - dev->rlen;
@@ -603,14 +618,71 @@ void *omap3_xfer(void *hdl, uint32_t device, uint8_t *buf, int *len)
 	/* disable interrupts */
 	out32(base + OMAP3_MCSPI_IRQ_ENABLE_OFFSET, 0);	
 
-	/* un-force CS */
-	set_port((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FORCE_MODE_ONE, 0);
+	/* XFERLEVEL can only be changed with the channel disabled */
+	omap3_chan_ctrl(dev, id, dev->chan[id].ctrl);
+
+	return rc;
+}
+
+/*
+ * Exchanges longer than what WCNT in MCSPI_XFERLEVEL can count are done
+ * in chunks, with CS kept forced in between. On error the bytes that
+ * were exchanged before it are reported.
+ */
+void *omap3_xfer(void *hdl, uint32_t device, uint8_t *buf, int *len)
+{
+	omap3_spi_t	*dev = hdl;
+	uintptr_t	base = dev->vbase;
+	uint32_t	id;
+	uint32_t	conf;
+	int			total, done, chunk;
+
+	id = device & SPI_DEV_ID_MASK;
+	if (id >= dev->num_cs) {
+		*len = -1;
+		return buf;
+	}
+
+	total = *len;
+	dev->dlen = ((devlist[id].cfg.mode & SPI_MODE_CHAR_LEN_MASK) + 7) >> 3;
+
+	/* The transfer len must be integer multiple of the word width */
+	if (total % dev->dlen) {
+		*len = -1;
+		return buf;
+	}
+
+	// Estimate transfer time in us... The calculated dtime is only used for
+	// the timeout, so it doesn't have to be that accurate. At higher clock
+	// rates, a calcuated dtime of 0 would mess-up the timeout calculation, so
+	// round up to 1 us
+	dev->dtime = dev->dlen * 1000 * 1000 / devlist[id].cfg.clock_rate;
+	if (dev->dtime == 0)
+		dev->dtime = 1;
+
+	/* set FIFO */
+	conf = (SPI_COMM_TX_RX << 12) | dev->chan[id].conf | OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW;
+	omap3_setup(dev, id, conf);
+
+	/* force CS */
+	omap3_chan_conf(dev, id, conf | OMAP3_MCSPI_FORCE_MODE_ONE);
+
+	for (done = 0; done < total; done += chunk) {
+		chunk = min(total - done, OMAP3_SPI_CHUNK * dev->dlen);
+		if (omap3_xfer_chunk(dev, id, buf + done, chunk)) {
+			done += dev->rlen;
+			if (done == 0)
+				done = -1;
+			break;
+		}
+	}
+
+	/* un-force CS, the FIFO stays enabled for the next transfer on this chip-select */
+	omap3_chan_conf(dev, id, conf);
 
-	set_port(base + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, OMAP3_MCSPI_CHANNEL_ENABLE, 0);
-	set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW, 0);
 	out32(base + OMAP3_MCSPI_XFERLEVEL_OFFSET , 0);
 	
-	*len = dev->rlen;
+	*len = done;
 
 	return buf;
 }
@@ -620,11 +692,16 @@ int omap3_dmaxfer(void *hdl, uint32_t device, spi_dma_paddr_t *paddr, int len)
 	omap3_spi_t	*dev = hdl;
 	int	id = device & SPI_DEV_ID_MASK;
 	uintptr_t	base = dev->vbase;
+	uint32_t	conf, fifo;
+	int			done, more, late = 0;
 
 	/* Is the EDMA disabled? */
 	if (dev->edma == 0 || id >= dev->num_cs)
 		return -1;
 
+	if (len <= 0)
+		return 0;
+
 	dev->dlen = ((devlist[id].cfg.mode & SPI_MODE_CHAR_LEN_MASK) + 7) >> 3;
 
 	/* The transfer len must be integer multiple of the word width */
@@ -633,6 +710,13 @@ int omap3_dmaxfer(void *hdl, uint32_t device, spi_dma_paddr_t *paddr, int len)
 		return -1;
 	}
 
+	/* Without queueing, an exchange must fit in the PaRAM sets */
+	if (!dev->edma_dbuf && len / dev->dlen > OMAP3_EDMA_NSETS * OMAP3_EDMA_SEG) {
+		fprintf(stderr, "spi-dm816x: DMA exchange longer than %d elements needs edmadbuf=1!\n",
+			OMAP3_EDMA_NSETS * OMAP3_EDMA_SEG);
+		return -1;
+	}
+
 	// Estimate transfer time in us... The calculated dtime is only used for
 	// the timeout, so it doesn't have to be that accurate. At higher clock
 	// rates, a calcuated dtime of 0 would mess-up the timeout calculation, so
@@ -641,58 +725,66 @@ int omap3_dmaxfer(void *hdl, uint32_t device, spi_dma_paddr_t *paddr, int len)
 	if (dev->dtime == 0)
 		dev->dtime = 1;
 
-	omap3_setup(dev, device);
-	
-	if (omap3_setup_edma(dev, id, paddr, len)) {
-		fprintf(stderr, "spi-dm816x: DMA XFER Timeout!!!\n");
-		return -1;
-	}
-
 	switch (dev->fifo) {
-		case 0:
-			set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + (OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW, 0);	
-			break;
-		case 1:				
-			set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + (OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FFER, OMAP3_MCSPI_FFER);	
+		case 1:
+			fifo = OMAP3_MCSPI_FFER;
 			break;
 		case 2:
-			set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + (OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FFEW, OMAP3_MCSPI_FFEW);	
+			fifo = OMAP3_MCSPI_FFEW;
 			break;
-		case 3:				
-			set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + (OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW, OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW);	
+		case 3:
+			fifo = OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW;
 			break;
 		default:
-			 set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + (OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW, 0);	
-			 break;
+			fifo = 0;
+			break;
 	}
+	conf = (SPI_COMM_TX_RX << 12) | dev->chan[id].conf | fifo;
+	omap3_setup(dev, id, conf);
+
+	len = omap3_edma_start(dev, id, paddr, len);
 
-	if (dev->fifo >= 1 && dev->fifo <= 3)
+	if (fifo)
 		out32(base + OMAP3_MCSPI_MODCTRL_OFFSET, in32(base + OMAP3_MCSPI_MODCTRL_OFFSET) | OMAP3_MCSPI_MODCTRL_FDAA);
 
 	/* Enable edma request	*/
-	set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + (OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_DMAR | OMAP3_MCSPI_DMAW, OMAP3_MCSPI_DMAR | OMAP3_MCSPI_DMAW);
+	omap3_chan_conf(dev, id, conf | OMAP3_MCSPI_DMAR | OMAP3_MCSPI_DMAW);
 
 	/* Configue the SPI control register to enable the corresponding channel of the SPI */ 
-	set_port(base + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, OMAP3_MCSPI_CHANNEL_ENABLE, OMAP3_MCSPI_CHANNEL_ENABLE);
+	omap3_chan_ctrl(dev, id, dev->chan[id].ctrl | OMAP3_MCSPI_CHANNEL_ENABLE);
 
 	/* force CS */
-	set_port((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FORCE_MODE_ONE, OMAP3_MCSPI_FORCE_MODE_ONE);
+	omap3_chan_conf(dev, id, conf | OMAP3_MCSPI_DMAR | OMAP3_MCSPI_DMAW | OMAP3_MCSPI_FORCE_MODE_ONE);
 
-	if (omap3_wait(dev,len * 10)) {
-		fprintf(stderr, "spi-dm816x: DMA XFER Timeout!!!\n");
-		len = -1;
-	}
+	/* One completion per segment that frees a reload set, and the last one */
+	do {
+		if (omap3_wait(dev, min(len, OMAP3_EDMA_SEG * dev->dlen) * 10)) {
+			fprintf(stderr, "spi-dm816x: DMA XFER Timeout!!!\n");
+			len = -1;
+			break;
+		}
+		if ((more = omap3_edma_next(dev)) == -1) {
+			fprintf(stderr, "spi-dm816x: DMA segment queued too late, exchange aborted\n");
+			late = 1;
+		}
+	} while (more > 0);
 
 	/* un-force CS */
-	set_port((base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id), OMAP3_MCSPI_FORCE_MODE_ONE, 0);
+	omap3_chan_conf(dev, id, conf | OMAP3_MCSPI_DMAR | OMAP3_MCSPI_DMAW);
 
 	/*
 	 * Disable SDMA request and SPI function
 	 */
-	set_port(base + OMAP3_MCSPI_CH1_CTRL_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, OMAP3_MCSPI_CHANNEL_ENABLE, 0);
-	set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, OMAP3_MCSPI_DMAR|OMAP3_MCSPI_DMAW, 0);
-	set_port(base + OMAP3_MCSPI_CH1_CONFIG_OFFSET + OMAP3_SPI_DEVICE_OFFSET * id, OMAP3_MCSPI_FFER | OMAP3_MCSPI_FFEW, 0);
-	if (dev->fifo >= 1 && dev->fifo <= 3)
+	omap3_chan_ctrl(dev, id, dev->chan[id].ctrl);
+	omap3_chan_conf(dev, id, conf);
+
+	/* Report what was exchanged before the timeout */
+	if (len == -1 && (done = omap3_edma_progress(dev)) > 0)
+		len = done;
+	if (late)
+		len = -1;
+
+	if (fifo)
 		out32(base + OMAP3_MCSPI_MODCTRL_OFFSET, in32(base + OMAP3_MCSPI_MODCTRL_OFFSET) & (~OMAP3_MCSPI_MODCTRL_FDAA));
 
 	omap3_edma_disablespi(dev);
@@ -700,6 +792,37 @@ int omap3_dmaxfer(void *hdl, uint32_t device, spi_dma_paddr_t *paddr, int len)
 	return len;	
 }
 
+/*
+ * Driver specific devctls, see <hw/spi-dm816x.h>
+ */
+int spi_drv_devctl(void *hdl, int dcmd, void *data, int nbytes, int *obytes)
+{
+	omap3_spi_t	*dev = hdl;
+	dm816x_spi_stats_t	*st = data;
+	omap3_chan_t	*ch;
+	uint32_t	id, flags;
+
+	switch (dcmd) {
+		case DCMD_SPI_DM816X_STATS:
+			if (nbytes < sizeof(*st))
+				return (EINVAL);
+			id = st->device & SPI_DEV_ID_MASK;
+			if (id >= dev->num_cs)
+				return (EINVAL);
+			ch = &dev->chan[id];
+			flags = st->flags;
+			*st = ch->stats;
+			st->device = id;
+			st->flags = flags;
+			if (flags & DM816X_SPI_STATS_CLR)
+				memset(&ch->stats, 0, sizeof(ch->stats));
+			*obytes = sizeof(*st);
+			return (EOK);
+	}
+
+	return (ENOSYS);
+}
+
 #if defined(__QNXNTO__) && defined(__USESRCVERSION)
 #include <sys/srcversion.h>
 __SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/spi/dm816x/omap3spi.c $ $Rev: 740148 $")
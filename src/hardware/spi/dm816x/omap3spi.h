@@ -36,6 +36,7 @@
 #include <sys/rsrcdbmsg.h>
 #include <hw/inout.h>
 #include <hw/spi-master.h>
+#include <hw/spi-dm816x.h>
 #include <arm/dm6446.h>
 
 #ifndef write_omap
@@ -97,6 +98,42 @@ typedef struct {
 } edma_t;
 
 
+/* Register image of one chip-select channel. conf and ctrl are rebuilt
+ * only when the configuration changes, hw_conf and hw_ctrl shadow what
+ * was last written so that transfers skip writes that change nothing.
+ */
+typedef struct {
+	uint32_t	conf;		/* CHxCONF from omap3_cfg(), without per-transfer bits */
+	uint32_t	ctrl;		/* CHxCTRL EXTCLK, channel disabled */
+	uint32_t	hw_conf;	/* OMAP3_CHAN_UNKNOWN after a direct write */
+	uint32_t	hw_ctrl;
+	edma_t		txparam;	/* EDMA PaRAM templates, built for edma_dlen */
+	edma_t		rxparam;
+	int			edma_dlen;
+	dm816x_spi_stats_t	stats;
+} omap3_chan_t;
+
+#define OMAP3_CHAN_UNKNOWN			0xFFFFFFFF	/* reserved bits set, never written */
+
+/* A DMA exchange is split in segments of up to OMAP3_EDMA_SEG data
+ * elements. The first one is in the channel PaRAM set, the next ones in
+ * the two reload sets at channel + OMAP3_EDMA_RELOAD and
+ * channel + 2 * OMAP3_EDMA_RELOAD, in turn. A set only links to the
+ * set of the next segment once that segment has been queued.
+ */
+typedef struct {
+	uint32_t	tx;			/* physical address of the first segment */
+	uint32_t	rx;
+	int			rxinc;		/* 0 when receiving into the dummy buffer */
+	int			elems;		/* data elements in the exchange */
+	int			nseg;
+	int			irq;		/* segment that raises the next completion */
+} omap3_edma_xfer_t;
+
+#define OMAP3_EDMA_SEG				0x8000
+#define OMAP3_EDMA_RELOAD			64
+#define OMAP3_EDMA_NSETS			3
+
 /* The structure which maintains the various parameters 
  * of the SPI module. 
  */ 
@@ -138,6 +175,11 @@ typedef struct {
 	int		pwr;			// Power management 
 	int		ocp;			// Internal OCP Clock gating strategy 
 	int		pin;			// 0:use, 1:not-use PIN34: pin mode selection
+	int		fifo_id;		// channel that has FFER/FFEW left set, -1 for none
+	int		edma_dbuf;		// 1:queue segments while the exchange runs
+	int		edma_tmpl;		// device the reload sets are programmed for, -1 for none
+	omap3_edma_xfer_t	edx;
+	omap3_chan_t	chan[NUM_OF_SPI_DEVS];
 } omap3_spi_t;
 
 #define OMAP3_SPI_INPUT_CLOCK		48000000
@@ -155,6 +197,7 @@ typedef struct {
 
 #define OMAP3_SPI_REGLEN			0x2000
 #define OMAP3_SPI_FIFOLEN			16 /* Half of the available FIFO for transmit/receive */
+#define OMAP3_SPI_CHUNK				0x8000 /* Words per exchange chunk, WCNT is 16 bits */
 
 #define OMAP3_SPI_REV				0x00
 #define OMAP3_SPI_SCR				0x10
@@ -317,8 +360,12 @@ extern int omap3_wait(omap3_spi_t *dev, int len);
 extern void *omap3_xfer(void *hdl, uint32_t device, uint8_t *buf, int *len);
 extern int omap3_dmaxfer(void *hdl, uint32_t device, spi_dma_paddr_t *paddr, int len);
 extern int omap3_cfg(void *hdl, spi_cfg_t *cfg, uint16_t* ext_div);
+extern int spi_drv_devctl(void *hdl, int dcmd, void *data, int nbytes, int *obytes);
 
-extern int omap3_setup_edma(omap3_spi_t *omap3, int device, spi_dma_paddr_t *paddr, int len);
+extern int omap3_edma_start(omap3_spi_t *omap3, int device, spi_dma_paddr_t *paddr, int len);
+extern int omap3_edma_next(omap3_spi_t *omap3);
+extern int omap3_edma_done(omap3_spi_t *omap3);
+extern int omap3_edma_progress(omap3_spi_t *omap3);
 extern int omap3_init_edma(omap3_spi_t *omap3);
 extern void omap3_edma_disablespi(omap3_spi_t *omap3);
 extern paddr_t mphys(void *);
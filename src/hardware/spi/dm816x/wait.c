@@ -47,14 +47,15 @@ int omap3_wait(omap3_spi_t *dev, int len)
 					return 0;
 			case OMAP3_EDMA_EVENT:
 				{
-					param = (edma_t *)(dev->edmavbase + DM6446_EDMA_PARAM_BASE + (0x20 * dev->edma_rx_chid));
+					int		done = omap3_edma_done(dev);
+
 					/* Unmask the Interrupt */
 					InterruptUnmask(dev->irq_edma, dev->iid_edma);
-//					fprintf(stderr, "omap3_wait(%d): %x %x\n", __LINE__, param->abcnt , param->ccnt);
-					if (param->abcnt != 0 || param->ccnt != 0){
-//						fprintf(stderr, "omap3_wait(%d): %x %x\n", __LINE__, param->abcnt , param->ccnt);
+
+					/* Each channel has its own interrupt (0x200 + chid), a pulse without the
+					 * IPR bit is a stale event whose completion was already consumed */
+					if (!done)
 						continue;
-					}
 					return 0;
 				}
 		}
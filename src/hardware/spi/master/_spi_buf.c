@@ -0,0 +1,80 @@
+/*
+ * $QNXLicenseC: 
+ * Copyright 2007, 2008, QNX Software Systems.  
+ *  
+ * Licensed under the Apache License, Version 2.0 (the "License"). You  
+ * may not reproduce, modify or distribute this software except in  
+ * compliance with the License. You may obtain a copy of the License  
+ * at: http://www.apache.org/licenses/LICENSE-2.0  
+ *  
+ * Unless required by applicable law or agreed to in writing, software  
+ * distributed under the License is distributed on an "AS IS" basis,  
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied. 
+ * 
+ * This file may contain contributions from others, either as  
+ * contributors under the License or as licensors under other terms.   
+ * Please review this entire file for other proprietary rights or license  
+ * notices, as well as the QNX Development Suite License Guide at  
+ * http://licensing.qnx.com/license-guide/ for other information. 
+ * $ 
+ */
+
+
+
+
+
+#include "proto.h"
+
+/*
+ * Buffers for messages that do not fit the receive buffer. Sizes up to
+ * 1 << (SPI_BUF_SHIFT + SPI_BUF_CLASSES - 1) are rounded up to a power of
+ * two and each class keeps its buffer, so a client whose transfer size
+ * varies does not cause a free()/malloc() on every growth. Larger ones
+ * share one buffer sized for the largest request seen.
+ *
+ * The dispatch thread of the device is the only user, the buffer stays
+ * valid until the reply of the current request has been sent.
+ */
+uint8_t *
+_spi_buf_get(spi_dev_t *dev, int len)
+{
+	int			cls;
+
+	for (cls = 0; cls < SPI_BUF_CLASSES; cls++) {
+		if (len <= (1 << (SPI_BUF_SHIFT + cls))) {
+			if (dev->bufs[cls] == NULL)
+				dev->bufs[cls] = malloc(1 << (SPI_BUF_SHIFT + cls));
+			return (dev->bufs[cls]);
+		}
+	}
+
+	if (dev->buflen < len) {
+		dev->buflen = len;
+		if (dev->buf)
+			free(dev->buf);
+		if ((dev->buf = malloc(dev->buflen)) == NULL)
+			dev->buflen = 0;
+	}
+
+	return (dev->buf);
+}
+
+void
+_spi_buf_free(spi_dev_t *dev)
+{
+	int			cls;
+
+	for (cls = 0; cls < SPI_BUF_CLASSES; cls++) {
+		free(dev->bufs[cls]);
+		dev->bufs[cls] = NULL;
+	}
+
+	free(dev->buf);
+	dev->buf = NULL;
+	dev->buflen = 0;
+}
+
+#if defined(__QNXNTO__) && defined(__USESRCVERSION)
+#include <sys/srcversion.h>
+__SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/spi/master/_spi_buf.c $ $Rev: 765543 $")
+#endif
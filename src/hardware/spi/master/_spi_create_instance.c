@@ -42,7 +42,7 @@ static int _spi_register_interface(void *data)
 	/* set up i/o handler functions */
 	memset(&rattr, 0, sizeof(rattr));
 	rattr.nparts_max   = SPI_RESMGR_NPARTS_MIN;
-	rattr.msg_max_size = SPI_RESMGR_MSGSIZE_MIN;
+	rattr.msg_max_size = msgsize;
 
 	iofunc_attr_init(&drvhdl->attr, S_IFCHR | devperm, NULL, NULL);
 	drvhdl->attr.mount = &_spi_mount;
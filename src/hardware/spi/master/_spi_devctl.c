@@ -120,6 +120,25 @@ _spi_devctl(resmgr_context_t *ctp, io_devctl_t *msg, spi_ocb_t *ocb)
 			msg->o.nbytes = sizeof(spi_drvinfo_t);
 			return _RESMGR_PTR(ctp, msg, sizeof(msg->o) + sizeof(spi_drvinfo_t));
 		}
+
+		default:
+		{
+			int		obytes = 0;
+
+			if (dev->devctl == NULL)
+				break;
+
+			if (msg->i.nbytes > ctp->msg_max_size - sizeof(msg->i))
+				return EINVAL;
+
+			status = dev->devctl(drvhdl, msg->i.dcmd, _DEVCTL_DATA(msg->i), msg->i.nbytes, &obytes);
+			if (status != EOK)
+				return status;
+
+			memset(&msg->o, 0, sizeof(msg->o));
+			msg->o.nbytes = obytes;
+			return _RESMGR_PTR(ctp, msg, sizeof(msg->o) + obytes);
+		}
 	}
 
 	return ENOSYS;
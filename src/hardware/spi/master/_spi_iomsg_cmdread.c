@@ -41,23 +41,14 @@ _spi_iomsg_cmdread(resmgr_context_t *ctp, io_msg_t *msg, spi_ocb_t *ocb)
 	msglen = spimsg->msg_hdr.i.combine_len + spimsg->xlen;
 
 	if (msglen > ctp->msg_max_size) {
-		if (dev->buflen < msglen) {
-			dev->buflen = msglen;
-			if (dev->buf)
-				free(dev->buf);
-			if ((dev->buf = malloc(dev->buflen)) == NULL) {
-				dev->buflen = 0;
-				return ENOMEM;
-			}
-		}
+		if ((buf = _spi_buf_get(dev, msglen)) == NULL)
+			return ENOMEM;
 
-		status = resmgr_msgread(ctp, dev->buf, spimsg->msg_hdr.i.combine_len, 0);
+		status = resmgr_msgread(ctp, buf, spimsg->msg_hdr.i.combine_len, 0);
 		if (status < 0)
 			return errno;
 		if (status < spimsg->msg_hdr.i.combine_len)
 			return EFAULT;
-
-		buf = dev->buf;
 	}
 	else
 		buf = (uint8_t *)msg;
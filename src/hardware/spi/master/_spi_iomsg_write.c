@@ -45,23 +45,14 @@ _spi_iomsg_write(resmgr_context_t *ctp, io_msg_t *msg, spi_ocb_t *ocb)
 	msglen = nbytes + sizeof(spi_msg_t);
 
 	if (msglen > ctp->msg_max_size) {
-		if (dev->buflen < msglen) {
-			dev->buflen = msglen;
-			if (dev->buf)
-				free(dev->buf);
-			if ((dev->buf = malloc(dev->buflen)) == NULL) {
-				dev->buflen = 0;
-				return ENOMEM;
-			}
-		}
-
-		status = resmgr_msgread(ctp, dev->buf, msglen, 0);
+		if ((buf = _spi_buf_get(dev, msglen)) == NULL)
+			return ENOMEM;
+
+		status = resmgr_msgread(ctp, buf, msglen, 0);
 		if (status < 0)
 			return errno;
 		if (status < msglen)
 			return EFAULT;
-
-		buf = dev->buf;
 	}
 	else
 		buf = (uint8_t *)msg;
@@ -29,6 +29,8 @@ Options:
 -u unit    Set spi unit number (default: 0).
 -d         driver module name
 -P         device file permissions (default: 0666)
+-m size    receive buffer size, messages that fit are handled in place
+           without a copy (default and minimum: 2048)
 #endif
 
 
@@ -39,6 +41,7 @@ Options:
 // globals
 char     *UserParm;
 unsigned devperm;
+unsigned msgsize;
 
 int main(int argc, char *argv[])
 {
@@ -52,6 +55,7 @@ int main(int argc, char *argv[])
 	
 	/* default permission for /dev/spi* entry */
 	devperm = 0666;		
+	msgsize = SPI_RESMGR_MSGSIZE_MIN;
 	
 	if (ThreadCtl(_NTO_TCTL_IO, 0) == -1) {
 		perror("ThreadCtl");
@@ -60,7 +64,7 @@ int main(int argc, char *argv[])
 
 	_spi_init_iofunc();
 
-	while ((c = getopt(argc, argv, "u:U:P:d:")) != -1) {
+	while ((c = getopt(argc, argv, "u:U:P:m:d:")) != -1) {
 		switch (c) {
 			case 'u':
 				devnum = strtol(optarg, NULL, 0);
@@ -73,6 +77,9 @@ int main(int argc, char *argv[])
 					devperm = strtoul(optarg, NULL, 8);	// octal
 				}
 				break;
+			case 'm':
+				msgsize = max(strtoul(optarg, NULL, 0), SPI_RESMGR_MSGSIZE_MIN);
+				break;
 			case 'd':
 				if ((drventry = _spi_dlload(&dlhdl, optarg)) == NULL) {
 					perror("spi_load_driver() failed");
@@ -89,6 +96,7 @@ int main(int argc, char *argv[])
 						dev->opts = strdup(argv[optind]);
 					++optind;
 					dev->funcs  = (spi_funcs_t *)drventry;
+					dev->devctl = (spi_drv_devctl_t *)dlsym(dlhdl, "spi_drv_devctl");
 					dev->devnum = devnum++;
 					dev->dlhdl  = dlhdl;
 
@@ -157,6 +165,8 @@ cleanup:
 
 		head = dev->next;
 
+		_spi_buf_free(dev);
+
 		if (dev->opts)
 			free(dev->opts);
 
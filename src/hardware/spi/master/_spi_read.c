@@ -54,16 +54,8 @@ _spi_read(resmgr_context_t *ctp, io_read_t *msg, spi_ocb_t *ocb)
     /* check if message buffer is too short */
     nbytes = msg->i.nbytes;
     if (nbytes > ctp->msg_max_size) {
-        if (dev->buflen < nbytes) {
-            dev->buflen = nbytes;
-			if (dev->buf)
-            	free(dev->buf);
-            if (NULL == (dev->buf = malloc(dev->buflen))) {
-                dev->buflen = 0;
-                return ENOMEM;
-            }
-        }
-        buf = dev->buf;
+        if ((buf = _spi_buf_get(dev, nbytes)) == NULL)
+            return ENOMEM;
     }
 	else
         buf = (uint8_t *)msg;
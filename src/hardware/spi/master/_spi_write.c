@@ -53,23 +53,14 @@ _spi_write(resmgr_context_t *ctp, io_write_t *msg, spi_ocb_t *ocb)
 
     /* check if message buffer is too short */
     if ((sizeof(msg->i) + nbytes) > ctp->msg_max_size) {
-        if (dev->buflen < nbytes) {
-            dev->buflen = nbytes;
-			if (dev->buf)
-            	free(dev->buf);
-            if (NULL == (dev->buf = malloc(dev->buflen))) {
-                dev->buflen = 0;
-                return ENOMEM;
-            }
-        }
-
-        status = resmgr_msgread(ctp, dev->buf, nbytes, sizeof(msg->i));
+        if ((buf = _spi_buf_get(dev, nbytes)) == NULL)
+            return ENOMEM;
+
+        status = resmgr_msgread(ctp, buf, nbytes, sizeof(msg->i));
         if (status < 0)
             return errno;
         if (status < nbytes)
             return EFAULT;
-
-        buf = dev->buf;
     }
 	else
         buf = ((uint8_t *)msg) + sizeof(msg->i);
@@ -41,6 +41,9 @@ struct spi_ocb;
 #define SPI_RESMGR_MSGSIZE_MIN  2048
 #define SPI_CLIENTS_MAX         32
 
+#define SPI_BUF_SHIFT           12      /* Smallest message buffer, 4KB */
+#define SPI_BUF_CLASSES         6       /* Power of two classes, up to 128KB */
+
 #define	SPI_EVENT				1
 #define	SPI_PRIORITY			24
 
@@ -56,6 +59,7 @@ extern iofunc_mount_t			_spi_mount;
 
 extern char						*UserParm;
 extern unsigned					devperm;
+extern unsigned					msgsize;
 
 typedef struct spi_ocb {
 	iofunc_ocb_t		hdr;
@@ -68,15 +72,23 @@ typedef struct spi_lock {
 	struct spi_lock		*next;
 } spi_lock_t;
 
+/*
+ * Optional driver entry "spi_drv_devctl", for driver specific devctls.
+ * data holds nbytes of input, the reply size is returned in *obytes.
+ */
+typedef int (spi_drv_devctl_t)(void *hdl, int dcmd, void *data, int nbytes, int *obytes);
+
 typedef struct spi_dev {
 	dispatch_t			*dpp;
 	dispatch_context_t	*ctp;
 	int					id;
 	spi_funcs_t			*funcs;
+	spi_drv_devctl_t	*devctl;
 
-	uint8_t				*buf;
+	uint8_t				*buf;		/* Messages over the largest class */
 	uint8_t				*dmabuf;
 	unsigned			buflen;
+	uint8_t				*bufs[SPI_BUF_CLASSES];
 
 	void				*drvhdl;
 	void				*dlhdl;
@@ -111,6 +123,8 @@ int _spi_iomsg_dmaxchange(resmgr_context_t *ctp, io_msg_t *msg, spi_ocb_t *ocb);
 int _spi_lock_check(resmgr_context_t *ctp, uint32_t device, spi_ocb_t *ocb);
 int _spi_unlock_dev(resmgr_context_t *ctp, uint32_t device, spi_ocb_t *ocb);
 int _spi_slogf(const char *fmt, ...);
+uint8_t *_spi_buf_get(spi_dev_t *dev, int len);
+void _spi_buf_free(spi_dev_t *dev);
 
 
 #endif
@@ -0,0 +1,62 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2014,2014, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#ifndef __SPI_DM816X_H_INCLUDED
+#define __SPI_DM816X_H_INCLUDED
+
+#include <stdint.h>
+#include <hw/spi-master.h>
+
+/*
+ * Driver specific devctls of spi-dm816x, handled through the optional
+ * spi_drv_devctl() entry of the driver. The command numbers start above
+ * the generic DCMD_SPI_* range.
+ */
+
+/**
+ * Per chip-select statistics.
+ * device - (in) chip-select
+ * flags  - (in) DM816X_SPI_STATS_CLR to reset the counters after reading them
+ */
+typedef struct _dm816x_spi_stats {
+	uint32_t	device;
+	uint32_t	flags;
+	uint64_t	xfers;			/* PIO and DMA transfers */
+	uint64_t	reconfigs;		/* Configuration changes through setcfg */
+	uint64_t	conf_writes;	/* CHxCONF writes */
+	uint64_t	ctrl_writes;	/* CHxCTRL writes */
+	uint64_t	conf_skipped;	/* Transfers that found the channel configured */
+	uint64_t	dma_xfers;		/* EDMA transfers */
+	uint64_t	dma_segs;		/* PaRAM segments, one per 32K data elements */
+	uint64_t	dma_refills;	/* Segments queued while the transfer was running */
+	uint32_t	reserved[10];
+} dm816x_spi_stats_t;
+
+#define DM816X_SPI_STATS_CLR		0x01
+
+#define DCMD_SPI_DM816X_STATS		__DIOTF(_DCMD_SPI, 0x80, dm816x_spi_stats_t)
+
+#endif
+
+#if defined(__QNXNTO__) && defined(__USESRCVERSION)
+#include <sys/srcversion.h>
+__SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/6.6.0/trunk/hardware/spi/public/hw/spi-dm816x.h $ $Rev: 765543 $")
+#endif